@@ -24,74 +24,115 @@ void UpdateCountdown(HiveState* state) {
   }
 }
 
+// Key of a position, which fits in 13 bits below layer 8.
+uint32_t PackPos(const Pos& pos) {
+  CHECK_LT(pos.z(), 8);
+  return pos.key();
+}
+
+Pos UnpackPos(uint32_t bits) { return Pos::FromKey(static_cast<uint16_t>(bits)); }
+
 }  // namespace
 
-HiveAction::HiveAction() {}
+void HiveAction::BuildPassAction() {
+  bits_ = static_cast<uint32_t>(ActionType::kPass) << kTypeShift;
+}
+
+void HiveAction::BuildMoveAction(const Move& move) {
+  bits_ = static_cast<uint32_t>(ActionType::kMove) << kTypeShift |
+          static_cast<uint32_t>(move.immobile_next_turn) << kImmobileShift |
+          PackPos(move.to) << kToShift | PackPos(move.from);
+}
 
-void HiveAction::BuildPassAction() { type = ActionType::kPass; }
-void HiveAction::BuildMoveAction(const Move& move_) {
-  type = ActionType::kMove;
-  move = move_;
+void HiveAction::BuildPlaceAction(const Place& place) {
+  bits_ = static_cast<uint32_t>(ActionType::kPlace) << kTypeShift |
+          PackPos(place.pos) << kToShift | static_cast<uint32_t>(place.piece_type);
 }
-void HiveAction::BuildPlaceAction(const Place& place_) {
-  type = ActionType::kPlace;
-  place = place_;
+
+Move HiveAction::GetMove() const {
+  CHECK(GetType() == ActionType::kMove);
+  return Move(UnpackPos(bits_ & kPosMask), UnpackPos((bits_ >> kToShift) & kPosMask),
+              (bits_ >> kImmobileShift) & 1);
 }
 
-void HiveAction::ExecuteMove(HiveState* state) {
-  Piece piece = state->pieces.at(move->from);
+Place HiveAction::GetPlace() const {
+  CHECK(GetType() == ActionType::kPlace);
+  return Place(UnpackPos((bits_ >> kToShift) & kPosMask),
+               static_cast<PieceType>(bits_ & kPosMask));
+}
+
+void HiveAction::ExecuteMove(HiveState* state) const {
+  const Move move = GetMove();
   // Sanity checks, can be commented out after testing.
-  CHECK(!state->IsStacked(move->from));
-  CHECK(!state->IsImmobile(move->from));
-  CHECK(state->IsEmpty(move->to));
+  CHECK(!state->IsStacked(move.from));
+  CHECK(!state->IsImmobile(move.from));
+  CHECK(state->IsEmpty(move.to));
   CHECK(state->AllowMovement());
-  CHECK(piece.side == state->active_player);
+  // A pillbug may move a piece of either side.
+  CHECK(move.immobile_next_turn || state->GetSide(move.from) == state->active_player);
 
-  state->pieces.erase(move->from);
-  state->pieces[move->to] = piece;
+  Piece piece = state->RemovePiece(move.from);
+  state->PutPiece(move.to, piece);
 
-  state->last_moved_piece = move->to;
-  if (move->immobile_next_turn) {
-    state->immobile_piece = move->to;
+  state->last_moved_piece = move.to;
+  if (move.immobile_next_turn) {
+    state->immobile_piece = move.to;
+  } else {
+    state->immobile_piece.reset();
   }
+  UpdateCountdown(state);
+  SwitchActivePlayer(state);
+  ++state->ply;
 }
 
-void HiveAction::ExecutePlace(HiveState* state) {
-  CHECK(state->IsEmpty(place->pos));
-  if (state->active_player == Side::kBlack) {
-    CHECK_GT(state->black_piece_count.at(place->piece_type), 0);
-    state->black_piece_count.at(place->piece_type) -= 1;
-    if (place->piece_type == PieceType::kQueen) {
+void HiveAction::ExecutePlace(HiveState* state) const {
+  const Place place = GetPlace();
+  CHECK(state->IsEmpty(place.pos));
+  int count = state->GetPieceCount(state->active_player, place.piece_type);
+  CHECK_GT(count, 0);
+  state->SetPieceCount(state->active_player, place.piece_type, count - 1);
+  if (place.piece_type == PieceType::kQueen) {
+    if (state->active_player == Side::kBlack) {
       state->black_queen_turn_countdown = -1;
-    }
-  } else {
-    CHECK_GT(state->white_piece_count.at(place->piece_type), 0);
-    state->white_piece_count.at(place->piece_type) -= 1;
-    if (place->piece_type == PieceType::kQueen) {
+    } else {
       state->white_queen_turn_countdown = -1;
     }
   }
-  state->pieces[place->pos] = Piece(place->piece_type, state->active_player);
+  state->PutPiece(place.pos, Piece(place.piece_type, state->active_player));
 
-  state->last_moved_piece = boost::none;
-  state->immobile_piece = boost::none;
+  state->last_moved_piece.reset();
+  state->immobile_piece.reset();
   UpdateCountdown(state);
   SwitchActivePlayer(state);
+  ++state->ply;
 }
 
-void HiveAction::ExecutePass(HiveState* state) {
-  state->last_moved_piece = boost::none;
-  state->immobile_piece = boost::none;
+void HiveAction::UndoMove(HiveState* state) const {
+  const Move move = GetMove();
+  Piece piece = state->RemovePiece(move.to);
+  state->PutPiece(move.from, piece);
+}
+
+void HiveAction::UndoPlace(HiveState* state) const {
+  const Place place = GetPlace();
+  Piece piece = state->RemovePiece(place.pos);
+  state->SetPieceCount(piece.side, piece.type, state->GetPieceCount(piece.side, piece.type) + 1);
+}
+
+void HiveAction::ExecutePass(HiveState* state) const {
+  state->last_moved_piece.reset();
+  state->immobile_piece.reset();
   UpdateCountdown(state);
   SwitchActivePlayer(state);
+  ++state->ply;
 }
 
 std::string HiveAction::DebugString() const {
-  switch (type) {
+  switch (GetType()) {
     case ActionType::kMove:
-      return move->DebugString();
+      return GetMove().DebugString();
     case ActionType::kPlace:
-      return place->DebugString();
+      return GetPlace().DebugString();
     case ActionType::kPass:
       return "Pass";
     default:
@@ -99,11 +140,10 @@ std::string HiveAction::DebugString() const {
   }
 }
 
-void HiveAction::print(std::ostream& strm) { strm << DebugString(); }
+void HiveAction::print(std::ostream& strm) const { strm << DebugString(); }
 
-void HiveAction::execute(HiveState* state) {
-  CHECK(type != ActionType::kUndefined);
-  switch (type) {
+void HiveAction::execute(HiveState* state) const {
+  switch (GetType()) {
     case ActionType::kMove:
       ExecuteMove(state);
       return;
@@ -118,25 +158,52 @@ void HiveAction::execute(HiveState* state) {
   }
 }
 
-std::vector<HiveAction> GetActionsForBoard(HiveState& state) {
-  std::vector<HiveAction> actions;
-  for (auto& place : GetPlaceActions(state)) {
-    HiveAction action;
-    action.BuildPlaceAction(std::move(place));
-    actions.push_back(std::move(action));
+void HiveAction::execute(HiveState* state, UndoRecord* record) const {
+  record->last_moved_piece = state->last_moved_piece;
+  record->immobile_piece = state->immobile_piece;
+  record->black_queen_turn_countdown = state->black_queen_turn_countdown;
+  record->white_queen_turn_countdown = state->white_queen_turn_countdown;
+  record->active_player = state->active_player;
+  execute(state);
+}
+
+void HiveAction::undo(HiveState* state, const UndoRecord& record) const {
+  switch (GetType()) {
+    case ActionType::kMove:
+      UndoMove(state);
+      break;
+    case ActionType::kPlace:
+      UndoPlace(state);
+      break;
+    case ActionType::kPass:
+      break;
+    default:
+      LOG(FATAL) << "Undefined action!";
+  }
+  state->last_moved_piece = record.last_moved_piece;
+  state->immobile_piece = record.immobile_piece;
+  state->black_queen_turn_countdown = record.black_queen_turn_countdown;
+  state->white_queen_turn_countdown = record.white_queen_turn_countdown;
+  state->active_player = record.active_player;
+  --state->ply;
+}
+
+void GetActionsForBoard(const HiveState& state, ActionList* actions) {
+  const int begin = actions->size();
+  PlaceOptions places;
+  GetPlaceOptions(state, &places);
+  for (int i = 0; i < places.size(); ++i) {
+    actions->emplace_back().BuildPlaceAction(places.at(i));
   }
-  for (auto& move : GetMoveActions(state)) {
-    HiveAction action;
-    action.BuildMoveAction(std::move(move));
-    actions.push_back(std::move(action));
+  MoveList moves;
+  GetMoveActions(state, &moves);
+  for (const auto& move : moves) {
+    actions->emplace_back().BuildMoveAction(move);
   }
-  if (actions.size() == 0) {
+  if (actions->size() == begin) {
     // Only pass if no available move.
-    HiveAction action;
-    action.BuildPassAction();
-    actions.push_back(std::move(action));
+    actions->emplace_back().BuildPassAction();
   }
-  return actions;
 }
 
-}  // namespace hive
\ No newline at end of file
+}  // namespace hive
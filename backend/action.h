@@ -1,39 +1,98 @@
+#pragma once
+
+#include <functional>
+#include <type_traits>
+
+#include "backend/fixed_vector.h"
 #include "backend/moves.h"
 #include "backend/place.h"
 #include "backend/state.h"
 
 namespace hive {
 
-class HiveAction : Action<HiveState> {
+// What executing an action overwrites and cannot be derived back from the action itself.
+struct UndoRecord {
+  OptionalPos last_moved_piece;
+  OptionalPos immobile_piece;
+  int8_t black_queen_turn_countdown = 0;
+  int8_t white_queen_turn_countdown = 0;
+  Side active_player = Side::kUndefined;
+};
+
+// One action packed in 32 bits, cheap to copy, compare, hash and store in arrays:
+//   bits 0-12   the position moved from, or the piece type placed,
+//   bits 13-25  the position moved or placed to,
+//   bit 26      set when a pillbug moves the piece, which cannot move next turn,
+//   bits 27-28  the ActionType.
+// Positions are stored as their cell index and layer (see Pos), so Move and Place are
+// given back with x and y in [-kBoardSize / 2, kBoardSize / 2).
+class HiveAction {
  public:
-  HiveAction();
-  virtual ~HiveAction() = default;
-  bool operator==(const HiveAction& other) const {
-    return type == other.type && move == other.move && place == other.place;
-  }
+  HiveAction() = default;
+  bool operator==(const HiveAction& other) const { return bits_ == other.bits_; }
   bool operator!=(const HiveAction& other) const { return !operator==(other); }
 
   // Builders
   void BuildPassAction();
-  void BuildMoveAction(const Move& move_);
-  void BuildPlaceAction(const Place& place_);
+  void BuildMoveAction(const Move& move);
+  void BuildPlaceAction(const Place& place);
+
+  ActionType GetType() const { return static_cast<ActionType>(bits_ >> kTypeShift); }
+  // Only valid for the matching type.
+  Move GetMove() const;
+  Place GetPlace() const;
+
+  // The packed value, unique per action.
+  uint32_t bits() const { return bits_; }
 
   std::string DebugString() const;
 
-  void execute(HiveState* state) override;
-  void print(std::ostream& strm) override;
+  void execute(HiveState* state) const;
+  // Same as execute(state), also saving in record what undo() needs.
+  void execute(HiveState* state, UndoRecord* record) const;
+  // Revert this action, which must be the last one executed on state.
+  // This lets search mutate a single state in place instead of copying it.
+  void undo(HiveState* state, const UndoRecord& record) const;
+  void print(std::ostream& strm) const;
+
+  friend std::ostream& operator<<(std::ostream& strm, const HiveAction& action) {
+    action.print(strm);
+    return strm;
+  }
+
+ private:
+  static constexpr int kPosBits = 13;
+  static constexpr uint32_t kPosMask = (1u << kPosBits) - 1;
+  static constexpr int kToShift = kPosBits;
+  static constexpr int kImmobileShift = 2 * kPosBits;
+  static constexpr int kTypeShift = kImmobileShift + 1;
 
- protected:
-  void ExecuteMove(HiveState* state);
-  void ExecutePlace(HiveState* state);
-  void ExecutePass(HiveState* state);
+  void ExecuteMove(HiveState* state) const;
+  void ExecutePlace(HiveState* state) const;
+  void ExecutePass(HiveState* state) const;
+  void UndoMove(HiveState* state) const;
+  void UndoPlace(HiveState* state) const;
 
-  ActionType type = ActionType::kUndefined;
-  boost::optional<Move> move;
-  boost::optional<Place> place;
+  uint32_t bits_ = 0;
 };
 
-// Get available actions from current board.
-std::vector<HiveAction> GetActionsForBoard(HiveState& state);
+static_assert(sizeof(HiveAction) == 4, "HiveAction must stay packed in 32 bits");
+static_assert(std::is_trivially_copyable<HiveAction>::value, "HiveAction must stay a plain value");
+
+// Upper bound of the actions in one position.
+constexpr int kMaxActions = 1024;
+using ActionList = FixedVector<HiveAction, kMaxActions>;
+
+// Get available actions from current board, appended to actions without heap allocation.
+void GetActionsForBoard(const HiveState& state, ActionList* actions);
+
+}  // namespace hive
+
+namespace std {
+
+template <>
+struct hash<hive::HiveAction> {
+  size_t operator()(const hive::HiveAction& action) const { return action.bits(); }
+};
 
-}  // namespace hive
\ No newline at end of file
+}  // namespace std
@@ -1,6 +1,10 @@
 
 #include "backend/action.h"
 
+#include <algorithm>
+#include <cstdint>
+
+#include "backend/allocation_counter.h"
 #include "glog/logging.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -15,4 +19,124 @@ TEST(ActionTest, Move) {}
 
 TEST(ActionTest, Place) {}
 
-TEST(ActionTest, Pass) {}
\ No newline at end of file
+TEST(ActionTest, Pass) {}
+
+TEST(ActionTest, Encoding) {
+  HiveAction move;
+  move.BuildMoveAction(Move(Pos(-3, 15), Pos(-16, 2, 4), /*immobile_next_turn=*/true));
+  EXPECT_EQ(move.GetType(), ActionType::kMove);
+  EXPECT_EQ(move.GetMove(), Move(Pos(-3, 15), Pos(-16, 2, 4), true));
+  // Positions come back wrapped into the board.
+  HiveAction wrapped;
+  wrapped.BuildMoveAction(Move(Pos(-3, 15), Pos(16, 2, 4), /*immobile_next_turn=*/true));
+  EXPECT_EQ(wrapped, move);
+
+  HiveAction place;
+  place.BuildPlaceAction(Place(Pos(1, -1), PieceType::kPillbug));
+  EXPECT_EQ(place.GetType(), ActionType::kPlace);
+  EXPECT_EQ(place.GetPlace(), Place(Pos(1, -1), PieceType::kPillbug));
+  EXPECT_NE(place.bits(), move.bits());
+
+  HiveAction pass;
+  pass.BuildPassAction();
+  EXPECT_EQ(pass.GetType(), ActionType::kPass);
+  EXPECT_EQ(HiveAction().GetType(), ActionType::kUndefined);
+}
+namespace {
+
+// Everything that makes up a state, independent of the order pieces were stored in.
+std::string Snapshot(const HiveState& state) {
+  std::vector<std::string> pieces;
+  state.ForEachPiece([&](const Pos& pos, const Piece& piece) {
+    pieces.push_back(pos.DebugString() + kPieceTypeName.at(piece.type) +
+                     std::to_string(static_cast<int>(piece.side)));
+  });
+  std::sort(pieces.begin(), pieces.end());
+  std::string snapshot = state.DebugString();
+  for (const auto& piece : pieces) {
+    snapshot += piece + " ";
+  }
+  return snapshot + std::to_string(state.black_queen_turn_countdown) + " " +
+         std::to_string(state.white_queen_turn_countdown);
+}
+
+}  // namespace
+
+TEST(ActionTest, HashTransposition) {
+  // The same placements in a different order reach the same key.
+  auto play = [](const std::vector<Place>& places) {
+    HiveState state;
+    state.Initialize(InitOption());
+    for (const auto& place : places) {
+      HiveAction action;
+      action.BuildPlaceAction(place);
+      action.execute(&state);
+    }
+    return state;
+  };
+  HiveState a = play({Place(Pos(0, 0), PieceType::kAnt), Place(Pos(1, 0), PieceType::kAnt),
+                      Place(Pos(-1, 0), PieceType::kSpider), Place(Pos(2, 0), PieceType::kBeetle),
+                      Place(Pos(-2, 0), PieceType::kBeetle)});
+  HiveState b = play({Place(Pos(0, 0), PieceType::kAnt), Place(Pos(1, 0), PieceType::kAnt),
+                      Place(Pos(-1, 0), PieceType::kBeetle), Place(Pos(2, 0), PieceType::kBeetle),
+                      Place(Pos(-2, 0), PieceType::kSpider)});
+  HiveState c = play({Place(Pos(0, 0), PieceType::kAnt), Place(Pos(1, 0), PieceType::kAnt),
+                      Place(Pos(-2, 0), PieceType::kSpider), Place(Pos(2, 0), PieceType::kBeetle),
+                      Place(Pos(-1, 0), PieceType::kBeetle)});
+  EXPECT_NE(a.Hash(), b.Hash());
+  EXPECT_EQ(b.Hash(), c.Hash());
+  EXPECT_EQ(c.Hash(), c.ComputeHash());
+
+  // Search keys also tell apart the ply and the last piece moved.
+  std::hash<HiveState> key;
+  EXPECT_EQ(key(b), key(c));
+  HiveState later = c;
+  later.ply += 2;
+  EXPECT_EQ(later.Hash(), c.Hash());
+  EXPECT_NE(key(later), key(c));
+  HiveState moved = c;
+  moved.last_moved_piece = Pos(2, 0);
+  EXPECT_NE(key(moved), key(c));
+}
+
+TEST(ActionTest, Undo) {
+  HiveState state;
+  InitOption option;
+  option.mosquito = true;
+  option.ladybug = true;
+  option.pillbug = true;
+  state.Initialize(option);
+  for (int ply = 0; ply < 120; ++ply) {
+    ActionList actions;
+    GetActionsForBoard(state, &actions);
+    const std::string before = Snapshot(state);
+    const uint64_t hash = state.Hash();
+    ASSERT_EQ(hash, state.ComputeHash());
+    for (auto& action : actions) {
+      UndoRecord record;
+      action.execute(&state, &record);
+      ASSERT_EQ(state.Hash(), state.ComputeHash()) << action.DebugString();
+      ASSERT_NE(state.Hash(), hash) << action.DebugString();
+      action.undo(&state, record);
+      ASSERT_EQ(Snapshot(state), before) << action.DebugString();
+      ASSERT_EQ(state.Hash(), hash) << action.DebugString();
+    }
+    actions[(ply * 13) % actions.size()].execute(&state);
+  }
+}
+
+TEST(ActionTest, NoAllocation) {
+  HiveState state;
+  InitOption option;
+  option.mosquito = true;
+  option.ladybug = true;
+  option.pillbug = true;
+  state.Initialize(option);
+  for (int ply = 0; ply < 120; ++ply) {
+    const int64_t before = GetNumAllocations();
+    ActionList actions;
+    GetActionsForBoard(state, &actions);
+    ASSERT_EQ(GetNumAllocations(), before) << state.DebugString();
+    actions[(ply * 13) % actions.size()].execute(&state);
+  }
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstdint>
+
+namespace hive {
+
+// Heap allocations made by the process so far, counted by the global operator new and new[]
+// replaced in allocation_counter.cc. Only binaries linking :allocation_counter count them.
+int64_t GetNumAllocations();
+
+}  // namespace hive
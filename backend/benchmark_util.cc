@@ -0,0 +1,38 @@
+#include "backend/benchmark_util.h"
+
+#include "backend/action.h"
+#include "glog/logging.h"
+
+namespace hive {
+
+HiveState PlayOpening(int num_plies) {
+  HiveState state;
+  InitOption option;
+  option.mosquito = true;
+  option.ladybug = true;
+  option.pillbug = true;
+  state.Initialize(option);
+  for (int i = 0; i < num_plies; ++i) {
+    ActionList actions;
+    GetActionsForBoard(state, &actions);
+    actions[(i * 7) % actions.size()].execute(&state);
+  }
+  return state;
+}
+
+HiveState GetCorpusPosition(int index) {
+  static constexpr int kPlies[kNumCorpusPositions] = {8, 16, 33};
+  CHECK_GE(index, 0);
+  CHECK_LT(index, kNumCorpusPositions);
+  HiveState state = PlayOpening(kPlies[index]);
+  CHECK(state.GetResult() == GameResult::kOngoing);
+  return state;
+}
+
+void ReportCounters(benchmark::State& bench_state, int64_t num_allocations, int64_t num_items) {
+  bench_state.SetItemsProcessed(num_items);
+  bench_state.counters["allocs/op"] = benchmark::Counter(
+      GetNumAllocations() - num_allocations, benchmark::Counter::kAvgIterations);
+}
+
+}  // namespace hive
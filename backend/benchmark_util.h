@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+
+#include "backend/allocation_counter.h"
+#include "backend/state.h"
+#include "benchmark/benchmark.h"
+
+namespace hive {
+
+// Play a fixed sequence of actions from the initial position, with all expansions.
+HiveState PlayOpening(int num_plies);
+
+// Fixed positions the benchmarks run on, indexed by the benchmark argument:
+//   0  small, 8 pieces,
+//   1  mid-game, 16 pieces,
+//   2  large, 24 pieces.
+constexpr int kNumCorpusPositions = 3;
+HiveState GetCorpusPosition(int index);
+
+// Report items per second and heap allocations per iteration, given GetNumAllocations() before
+// the benchmark loop. Time per iteration is reported by the library.
+void ReportCounters(benchmark::State& bench_state, int64_t num_allocations, int64_t num_items);
+
+}  // namespace hive
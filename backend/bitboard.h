@@ -0,0 +1,90 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "backend/fixed_vector.h"
+#include "backend/pos.h"
+
+namespace hive {
+
+// Upper bound of the empty cells touching a hive, which has at most 28 pieces.
+constexpr int kMaxPerimeter = 128;
+
+// Positions around the hive, e.g. the destinations of a piece or the cells to place on.
+using PosList = FixedVector<Pos, kMaxPerimeter>;
+
+// A position or nothing, in the 16 bits of a Pos key.
+class OptionalPos {
+ public:
+  OptionalPos() = default;
+  OptionalPos(const Pos& pos) : key_(pos.key()) {}
+
+  explicit operator bool() const { return key_ != kNone; }
+  Pos operator*() const { return Pos::FromKey(key_); }
+  void reset() { key_ = kNone; }
+
+  // If this holds the same board position as pos.
+  bool Holds(const Pos& pos) const { return key_ == pos.key(); }
+
+ private:
+  static constexpr uint16_t kNone = 0xffff;
+  uint16_t key_ = kNone;
+};
+
+// One bit per board cell.
+class Bitboard {
+ public:
+  bool Test(int cell) const { return (words_[cell >> 6] >> (cell & 63)) & 1; }
+  void Set(int cell) { words_[cell >> 6] |= uint64_t{1} << (cell & 63); }
+  void Reset(int cell) { words_[cell >> 6] &= ~(uint64_t{1} << (cell & 63)); }
+
+  bool Empty() const {
+    for (uint64_t word : words_) {
+      if (word != 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  int Count() const {
+    int count = 0;
+    for (uint64_t word : words_) {
+      count += __builtin_popcountll(word);
+    }
+    return count;
+  }
+
+  // Call f(cell) for every set cell, in increasing cell order.
+  template <typename F>
+  void ForEach(F&& f) const {
+    for (int i = 0; i < kWords; ++i) {
+      for (uint64_t word = words_[i]; word != 0; word &= word - 1) {
+        f(i * 64 + __builtin_ctzll(word));
+      }
+    }
+  }
+
+  Bitboard& operator|=(const Bitboard& other) {
+    for (int i = 0; i < kWords; ++i) {
+      words_[i] |= other.words_[i];
+    }
+    return *this;
+  }
+  Bitboard& operator&=(const Bitboard& other) {
+    for (int i = 0; i < kWords; ++i) {
+      words_[i] &= other.words_[i];
+    }
+    return *this;
+  }
+
+  bool operator==(const Bitboard& other) const { return words_ == other.words_; }
+  bool operator!=(const Bitboard& other) const { return !operator==(other); }
+
+ private:
+  static constexpr int kWords = kBoardCells / 64;
+  std::array<uint64_t, kWords> words_{};
+};
+
+}  // namespace hive
@@ -1,21 +1,31 @@
 #pragma once
 
+#include <cstdint>
+#include <unordered_map>
+
 namespace hive {
 
-enum class Side {
+enum class Side : uint8_t {
   kUndefined = 0,
   kBlack = 1,
   kWhite = 2,
 };
 
-enum class ActionType {
+enum class ActionType : uint8_t {
   kUndefined = 0,
   kPlace,
   kMove,
   kPass,
 };
 
-enum class PieceType {
+enum class GameResult : uint8_t {
+  kOngoing = 0,
+  kBlackWin,
+  kWhiteWin,
+  kDraw,
+};
+
+enum class PieceType : uint8_t {
   kUndefined = 0,
   kQueen,
   kBeetle,
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "glog/logging.h"
+
+namespace hive {
+
+// A vector holding at most N elements in place, never touching the heap.
+// Move generation fills these on the stack; going over the capacity is a fatal error.
+template <typename T, int N>
+class FixedVector {
+ public:
+  using value_type = T;
+  using iterator = T*;
+  using const_iterator = const T*;
+
+  FixedVector() = default;
+  FixedVector(const FixedVector& other) { *this = other; }
+  FixedVector& operator=(const FixedVector& other) {
+    if (this != &other) {
+      clear();
+      for (const T& value : other) {
+        push_back(value);
+      }
+    }
+    return *this;
+  }
+  ~FixedVector() { clear(); }
+
+  template <typename... Args>
+  T& emplace_back(Args&&... args) {
+    CHECK_LT(size_, N) << "FixedVector capacity exceeded";
+    T* value = new (&storage_[size_]) T(std::forward<Args>(args)...);
+    ++size_;
+    return *value;
+  }
+  void push_back(const T& value) { emplace_back(value); }
+
+  // Keep the first `size` elements.
+  void Truncate(int size) {
+    CHECK_LE(size, size_);
+    if (!std::is_trivially_destructible<T>::value) {
+      for (int i = size; i < size_; ++i) {
+        (*this)[i].~T();
+      }
+    }
+    size_ = size;
+  }
+  void clear() { Truncate(0); }
+
+  int size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  static constexpr int capacity() { return N; }
+
+  T& operator[](int i) { return begin()[i]; }
+  const T& operator[](int i) const { return begin()[i]; }
+  T& back() { return (*this)[size_ - 1]; }
+
+  T* begin() { return reinterpret_cast<T*>(storage_); }
+  T* end() { return begin() + size_; }
+  const T* begin() const { return reinterpret_cast<const T*>(storage_); }
+  const T* end() const { return begin() + size_; }
+
+ private:
+  typename std::aligned_storage<sizeof(T), alignof(T)>::type storage_[N];
+  int size_ = 0;
+};
+
+}  // namespace hive
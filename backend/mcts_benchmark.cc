@@ -0,0 +1,284 @@
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+#include "backend/benchmark_util.h"
+#include "backend/state.h"
+#include "backend/strategy.h"
+#include "benchmark/benchmark.h"
+
+namespace hive {
+namespace {
+
+using HiveMCTS = MCTS<HiveState, HiveAction, HiveExpansionStrategy, HivePlayoutStrategy>;
+
+constexpr int kIterations = 2000;
+
+// A search of kIterations from corpus position range(0), with playouts cut range(1) plies past
+// the root so that the tree, not the playouts, dominates, on range(2) threads sharing one tree,
+// or each searching its own if range(3) is set. Items are iterations, timed on the wall clock so
+// that they scale with the threads.
+void BM_Search(benchmark::State& bench_state) {
+  const HiveState root = GetCorpusPosition(bench_state.range(0));
+  const int max_plies = root.ply + bench_state.range(1);
+  const int64_t num_allocations = GetNumAllocations();
+  int64_t num_nodes = 0;
+  int64_t num_bytes = 0;
+  for (auto _ : bench_state) {
+    HiveMCTS mcts(new HiveState(root), new HiveBackpropagation(),
+                  new HiveTerminationCheck(max_plies), new HiveScoring());
+    mcts.setTime(0);
+    mcts.setMinIterations(kIterations);
+    mcts.setThreads(bench_state.range(2));
+    mcts.setRootParallel(bench_state.range(3));
+    std::unique_ptr<HiveAction> action(mcts.calculateAction());
+    num_nodes += mcts.getNumNodes();
+    num_bytes += mcts.getBytesUsed();
+  }
+  ReportCounters(bench_state, num_allocations, bench_state.iterations() * kIterations);
+  bench_state.counters["nodes"] =
+      benchmark::Counter(num_nodes, benchmark::Counter::kAvgIterations);
+  bench_state.counters["bytes/node"] = static_cast<double>(num_bytes) / num_nodes;
+}
+void SearchArgs(benchmark::internal::Benchmark* benchmark) {
+  for (int pos : {0, 2}) {
+    for (int plies : {10, kMaxPlies}) {
+      benchmark->Args({pos, plies, 1, 0});
+      for (int threads : {2, 4, 8}) {
+        benchmark->Args({pos, plies, threads, 0});
+        benchmark->Args({pos, plies, threads, 1});
+      }
+    }
+  }
+}
+BENCHMARK(BM_Search)
+    ->Apply(SearchArgs)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+// A search of kIterations from corpus position range(0), playouts cut 10 plies past the root,
+// storing a state in every node if range(1) is set, or only in the root, replaying the others.
+// Reports the nodes a GiB holds at the bytes per node of the search, and iterations per second.
+void BM_SearchNodeStates(benchmark::State& bench_state) {
+  const HiveState root = GetCorpusPosition(bench_state.range(0));
+  const int64_t num_allocations = GetNumAllocations();
+  int64_t num_nodes = 0;
+  int64_t num_bytes = 0;
+  for (auto _ : bench_state) {
+    HiveMCTS mcts(new HiveState(root), new HiveBackpropagation(),
+                  new HiveTerminationCheck(root.ply + 10), new HiveScoring());
+    mcts.setTime(0);
+    mcts.setMinIterations(kIterations);
+    mcts.setStoreStates(bench_state.range(1));
+    std::unique_ptr<HiveAction> action(mcts.calculateAction());
+    num_nodes += mcts.getNumNodes();
+    num_bytes += mcts.getBytesUsed();
+  }
+  ReportCounters(bench_state, num_allocations, bench_state.iterations() * kIterations);
+  bench_state.counters["bytes/node"] = static_cast<double>(num_bytes) / num_nodes;
+  bench_state.counters["Mnodes/GiB"] = static_cast<double>(1 << 30) * num_nodes / num_bytes / 1e6;
+}
+BENCHMARK(BM_SearchNodeStates)
+    ->Args({0, 1})
+    ->Args({0, 0})
+    ->Args({2, 1})
+    ->Args({2, 0})
+    ->Unit(benchmark::kMillisecond);
+
+constexpr int kBudgetIterations = 20000;
+
+// A search of kBudgetIterations from corpus position range(0), playouts cut 10 plies past the
+// root, with a budget of range(1) nodes or none. Reports the nodes and memory at the end, and the
+// number of times the tree was pruned to fit.
+void BM_SearchBudget(benchmark::State& bench_state) {
+  const HiveState root = GetCorpusPosition(bench_state.range(0));
+  const int64_t num_allocations = GetNumAllocations();
+  int64_t num_nodes = 0;
+  int64_t num_bytes = 0;
+  int64_t num_prunings = 0;
+  for (auto _ : bench_state) {
+    HiveMCTS mcts(new HiveState(root), new HiveBackpropagation(),
+                  new HiveTerminationCheck(root.ply + 10), new HiveScoring());
+    mcts.setTime(0);
+    mcts.setMinIterations(kBudgetIterations);
+    mcts.setMaxNodes(bench_state.range(1));
+    std::unique_ptr<HiveAction> action(mcts.calculateAction());
+    num_nodes += mcts.getNumNodes();
+    num_bytes += mcts.getMemoryUsed();
+    num_prunings += mcts.getNumPrunings();
+  }
+  ReportCounters(bench_state, num_allocations, bench_state.iterations() * kBudgetIterations);
+  bench_state.counters["nodes"] =
+      benchmark::Counter(num_nodes, benchmark::Counter::kAvgIterations);
+  bench_state.counters["MiB"] = benchmark::Counter(num_bytes / static_cast<double>(1 << 20),
+                                                  benchmark::Counter::kAvgIterations);
+  bench_state.counters["prunings"] =
+      benchmark::Counter(num_prunings, benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_SearchBudget)
+    ->Args({0, 0})
+    ->Args({0, 4096})
+    ->Args({0, 1024})
+    ->Unit(benchmark::kMillisecond);
+
+// Self-play of up to range(1) plies from corpus position range(0), searching kIterations per ply
+// and advancing the root through the chosen action. Reports the share of the tree kept per ply, and
+// the nodes kept, which the next search starts from instead of an empty root.
+void BM_TreeReuse(benchmark::State& bench_state) {
+  const HiveState root = GetCorpusPosition(bench_state.range(0));
+  const int num_plies = bench_state.range(1);
+  int64_t num_searches = 0;
+  int64_t num_nodes = 0;
+  int64_t num_kept = 0;
+  for (auto _ : bench_state) {
+    HiveMCTS mcts(new HiveState(root), new HiveBackpropagation(),
+                  new HiveTerminationCheck(root.ply + num_plies + 10), new HiveScoring());
+    mcts.setTime(0);
+    mcts.setMinIterations(kIterations);
+    for (int ply = 0; ply < num_plies; ++ply) {
+      if (mcts.getRoot().getData()->GetResult() != GameResult::kOngoing) {
+        break;
+      }
+      std::unique_ptr<HiveAction> action(mcts.calculateAction());
+      ++num_searches;
+      num_nodes += mcts.getNumNodes();
+      num_kept += mcts.advance(*action);
+    }
+  }
+  bench_state.SetItemsProcessed(num_searches);
+  bench_state.counters["kept/ply"] = static_cast<double>(num_kept) / num_searches;
+  bench_state.counters["kept%"] = 100.0 * num_kept / num_nodes;
+}
+BENCHMARK(BM_TreeReuse)->Args({0, 8})->Args({2, 8})->Unit(benchmark::kMillisecond);
+
+constexpr int kTranspositionIterations = 20000;
+
+// Counts the positions held by the nodes of a search, and the nodes holding a position another
+// node already holds, each of which was expanded and simulated again.
+void CountPositions(HiveMCTS* mcts, int64_t* num_positions, int64_t* num_duplicates) {
+  using HiveNode = Node<HiveState, HiveAction, HiveExpansionStrategy>;
+  std::unordered_set<size_t> keys;
+  std::unordered_set<HiveNode*> visited;
+  std::vector<HiveNode*> stack = {&mcts->getRoot()};
+  while (!stack.empty()) {
+    HiveNode* node = stack.back();
+    stack.pop_back();
+    if (!visited.insert(node).second) {
+      continue;
+    }
+    if (!keys.insert(std::hash<HiveState>()(*node->getData())).second) {
+      ++*num_duplicates;
+    }
+    node->getChildren().forEach(
+        [&](const HiveAction&, int, float, HiveNode* child) { stack.push_back(child); });
+  }
+  *num_positions += keys.size();
+}
+
+// A search of kTranspositionIterations from corpus position range(0), playouts cut 10 plies past
+// the root, with a transposition table of range(1) entries or none. Reports the bytes per
+// position held, the table included, the duplicate nodes and the share of expansions finding
+// their position in the table, each saving a node and a playout.
+void BM_SearchTranspositions(benchmark::State& bench_state) {
+  const HiveState root = GetCorpusPosition(bench_state.range(0));
+  int64_t num_positions = 0;
+  int64_t num_duplicates = 0;
+  int64_t num_bytes = 0;
+  uint64_t num_lookups = 0;
+  uint64_t num_hits = 0;
+  for (auto _ : bench_state) {
+    HiveMCTS mcts(new HiveState(root), new HiveBackpropagation(),
+                  new HiveTerminationCheck(root.ply + 10), new HiveScoring());
+    mcts.setTime(0);
+    mcts.setMinIterations(kTranspositionIterations);
+    mcts.setTranspositionTableSize(bench_state.range(1));
+    std::unique_ptr<HiveAction> action(mcts.calculateAction());
+    bench_state.PauseTiming();
+    CountPositions(&mcts, &num_positions, &num_duplicates);
+    num_bytes += mcts.getBytesUsed() + mcts.getTranspositionTableBytes();
+    num_lookups += mcts.getTranspositionLookups();
+    num_hits += mcts.getTranspositionHits();
+    bench_state.ResumeTiming();
+  }
+  bench_state.SetItemsProcessed(bench_state.iterations() * kTranspositionIterations);
+  bench_state.counters["bytes/position"] = static_cast<double>(num_bytes) / num_positions;
+  bench_state.counters["duplicates"] =
+      benchmark::Counter(num_duplicates, benchmark::Counter::kAvgIterations);
+  bench_state.counters["hit%"] = num_lookups ? 100.0 * num_hits / num_lookups : 0;
+}
+BENCHMARK(BM_SearchTranspositions)
+    ->Args({0, 0})
+    ->Args({0, 1 << 13})
+    ->Args({0, 1 << 16})
+    ->Args({2, 0})
+    ->Args({2, 1 << 13})
+    ->Unit(benchmark::kMillisecond);
+
+// Statistics of a child as the tree stored them before ChildArray: one heap node per child,
+// allocated next to its state.
+struct PointerNode {
+  int num_visits;
+  float score;
+};
+
+constexpr float kC = 0.5;
+
+// One UCT selection among range(0) children with ChildArray, as MCTS::select() does.
+void BM_SelectUCT(benchmark::State& bench_state) {
+  struct Child {};
+  Arena arena;
+  ChildArray<HiveAction, Child> children;
+  srand(0);
+  int parent_visits = 0;
+  for (int i = 0; i < bench_state.range(0); ++i) {
+    children.add(arena, HiveAction(), 0, [&](ChildArray<HiveAction, Child>::Slot slot) {
+      slot.visits() = 1 + rand() % 1000;
+      slot.score() = rand() % (slot.visits() + 1);
+      parent_visits += slot.visits();
+      return arena.create<Child>();
+    });
+  }
+  for (auto _ : bench_state) {
+    benchmark::DoNotOptimize(
+        children.selectUCT(static_cast<float>(std::log(parent_visits)), kC));
+  }
+  bench_state.SetItemsProcessed(bench_state.iterations() * bench_state.range(0));
+}
+BENCHMARK(BM_SelectUCT)->Arg(8)->Arg(32)->Arg(128)->Arg(512);
+
+// The same selection through a vector of heap nodes, with log() and sqrt() per child.
+void BM_SelectUCTPointers(benchmark::State& bench_state) {
+  srand(0);
+  int parent_visits = 0;
+  std::vector<std::unique_ptr<HiveState>> states;
+  std::vector<std::unique_ptr<PointerNode>> nodes;
+  std::vector<PointerNode*> children;
+  for (int i = 0; i < bench_state.range(0); ++i) {
+    states.emplace_back(new HiveState());
+    nodes.emplace_back(new PointerNode());
+    nodes.back()->num_visits = 1 + rand() % 1000;
+    nodes.back()->score = rand() % (nodes.back()->num_visits + 1);
+    parent_visits += nodes.back()->num_visits;
+    children.push_back(nodes.back().get());
+  }
+  for (auto _ : bench_state) {
+    PointerNode* best = nullptr;
+    float best_score = -std::numeric_limits<float>::max();
+    for (PointerNode* n : children) {
+      float score = n->score / n->num_visits +
+                    kC * static_cast<float>(sqrt(log(parent_visits) / n->num_visits));
+      if (score > best_score) {
+        best_score = score;
+        best = n;
+      }
+    }
+    benchmark::DoNotOptimize(best);
+  }
+  bench_state.SetItemsProcessed(bench_state.iterations() * bench_state.range(0));
+}
+BENCHMARK(BM_SelectUCTPointers)->Arg(8)->Arg(32)->Arg(128)->Arg(512);
+
+}  // namespace
+}  // namespace hive
@@ -1,57 +1,37 @@
 
 #include "backend/moves.h"
 
-#include <boost/functional/hash.hpp>
-#include <deque>
-#include <unordered_set>
-
+#include "backend/neighbour_table.h"
+#include "backend/perimeter_graph.h"
 #include "glog/logging.h"
 
 namespace hive {
 
 namespace {
 
-void SpiderRecursiveMove(HiveState& state, std::vector<Pos>& history,
-                         std::unordered_set<Move>& moves) {
-  if (history.size() == 4) {
-    moves.emplace(history.front(), history.back());
-    return;
-  }
-  Pos from = history.back();
-  for (const auto& to : from.GetAdjacentPositions()) {
-    if (!state.IsEmpty(to) || std::find(history.begin(), history.end(), to) != history.end() ||
-        !IsPieceMoveValid(state, from, to)) {
-      continue;
-    }
-    history.push_back(to);
-    SpiderRecursiveMove(state, history, moves);
-    history.pop_back();
-  }
+// The graph of the last board seen by this thread, with the last piece asked for lifted off.
+const PerimeterGraph& GetPerimeterGraph(const HiveState& state, const Pos& from) {
+  thread_local PerimeterGraph graph;
+  graph.Update(state, from);
+  return graph;
 }
 
-void LadybugRecursiveMove(HiveState& state, std::vector<Pos>& history,
-                          std::unordered_set<Move>& moves) {
-  if (history.size() == 4) {
-    moves.emplace(history.front(), history.back());
-    return;
+// Index in kAdjacentDirections of the step from "from" to "to", -1 if they are not adjacent.
+int GetDirection(const Pos& from, const Pos& to) {
+  // Indexed by [dx + 1][dy + 1].
+  static constexpr int kDirections[3][3] = {{-1, 3, 4}, {2, -1, 5}, {1, 0, -1}};
+  // Differences wrap around the board edges like positions do.
+  int dx = ((to.x() - from.x() + kBoardSize / 2) & kBoardMask) - kBoardSize / 2;
+  int dy = ((to.y() - from.y() + kBoardSize / 2) & kBoardMask) - kBoardSize / 2;
+  if (dx < -1 || dx > 1 || dy < -1 || dy > 1) {
+    return -1;
   }
-  const Pos from = history.back();
-  for (auto to : from.GetAdjacentPositions()) {
-    while (!state.IsEmpty(to)) {
-      to.z += 1;
-    }
-    if (history.size() == 3 && to.z != 0) {
-      continue;
-    } else if (history.size() < 3 && to.z == 0) {
-      continue;
-    }
-    if (std::find(history.begin(), history.end(), to) != history.end() ||
-        !IsPieceMoveValid(state, from, to)) {
-      continue;
-    }
-    history.push_back(to);
-    LadybugRecursiveMove(state, history, moves);
-    history.pop_back();
+  return kDirections[dx + 1][dy + 1];
+}
+
+void AddMoves(const Pos& from, const PosList& destinations, MoveList* moves) {
+  for (const Pos& to : destinations) {
+    moves->emplace_back(from, to);
   }
 }
 
@@ -61,193 +41,179 @@ bool Move::operator==(const Move& other) const {
   return from == other.from && to == other.to && immobile_next_turn == other.immobile_next_turn;
 }
 
-std::vector<Move> GetMoveByType(HiveState& state, const Pos& from, PieceType piece_type) {
+void GetMoveByType(const HiveState& state, const Pos& from, PieceType piece_type,
+                   MoveList* moves) {
   switch (piece_type) {
     case PieceType::kQueen:
-      return GetQueenMovePositions(state, from);
+      return GetQueenMovePositions(state, from, moves);
     case PieceType::kBeetle:
-      return GetBeetleMovePositions(state, from);
+      return GetBeetleMovePositions(state, from, moves);
     case PieceType::kGrasshopper:
-      return GetGrasshopperMovePositions(state, from);
+      return GetGrasshopperMovePositions(state, from, moves);
     case PieceType::kSpider:
-      return GetSpiderMovePositions(state, from);
+      return GetSpiderMovePositions(state, from, moves);
     case PieceType::kAnt:
-      return GetAntMovePositions(state, from);
+      return GetAntMovePositions(state, from, moves);
     case PieceType::kLadybug:
-      return GetLadybugMovePositions(state, from);
+      return GetLadybugMovePositions(state, from, moves);
     case PieceType::kMosquito:
-      return GetMosquitoMovePositions(state, from);
+      return GetMosquitoMovePositions(state, from, moves);
     case PieceType::kPillbug:
-      return GetPillbugMovePositions(state, from);
+      return GetPillbugMovePositions(state, from, moves);
     default:
       LOG(FATAL) << "Invalid piece";
-      return {};
   }
 }
 
-std::vector<Move> GetMovePositions(HiveState& state) {
-  std::vector<Move> moves;
-  if (!state.EnforceQueenPlacement()) {
-    for (const auto& pair : state.pieces) {
-      if (pair.second.side != state.active_player) {
-        continue;
-      }
-      const Pos& from = pair.first;
-      std::vector<Move> move_by_piece = GetMovePositions(state, from);
-      moves.insert(moves.end(), move_by_piece.begin(), move_by_piece.end());
-    }
+void GetMoveActions(const HiveState& state, MoveList* moves) {
+  if (!state.AllowMovement()) {
+    return;
+  }
+  // Collect first: generating moves lifts pieces off the shared perimeter graph.
+  PieceList movable_pieces;
+  GetMovablePieces(state, &movable_pieces);
+  for (const Pos& from : movable_pieces) {
+    GetMovePositions(state, from, moves);
   }
-  return moves;
 }
 
-std::vector<Move> GetMovePositions(HiveState& state, const Pos& from) {
+void GetMovablePieces(const HiveState& state, PieceList* pieces) {
+  state.ForEachPiece([&](const Pos& pos, const Piece& piece) {
+    if (piece.side == state.active_player && !state.IsStacked(pos)) {
+      pieces->push_back(pos);
+    }
+  });
+}
+
+void GetMovePositions(const HiveState& state, const Pos& from, MoveList* moves) {
   CHECK(!state.IsEmpty(from));
   if (state.IsStacked(from) || state.IsImmobile(from) || !IsHiveStillConnected(state, from)) {
     // In the following cases, a piece cannot move.
     // 1. It is stacked by another piece.
     // 2. It is rendered immobile by pillbug last turn.
     // 3. Hive would be not connected if we remove this piece.
-    return {};
+    return;
   }
   PieceType piece_type = state.GetPieceType(from);
-  return GetMoveByType(state, from, piece_type);
+  GetMoveByType(state, from, piece_type, moves);
 }
 
-std::vector<Move> GetQueenMovePositions(const HiveState& state, const Pos& from) {
-  CHECK(from.z == 0);
-  std::vector<Move> moves;
-  for (const auto& to : from.GetAdjacentPositions()) {
-    if (!state.IsEmpty(to) || !IsPieceMoveValid(state, from, to)) {
-      continue;
-    }
-    moves.emplace_back(from, to);
-  }
-  return moves;
-}  // namespace hive
+void GetQueenMovePositions(const HiveState& state, const Pos& from, MoveList* moves) {
+  CHECK(from.z() == 0);
+  PosList destinations;
+  GetPerimeterGraph(state, from).GetSlideDestinations(from, 1, &destinations);
+  AddMoves(from, destinations, moves);
+}
 
-std::vector<Move> GetBeetleMovePositions(const HiveState& state, const Pos& from) {
-  std::vector<Move> moves;
-  for (auto to : from.GetAdjacentPositions()) {
+void GetBeetleMovePositions(const HiveState& state, const Pos& from, MoveList* moves) {
+  for (int direction = 0; direction < 6; ++direction) {
+    Pos to = from.Adjacent(direction);
     while (!state.IsEmpty(to)) {
-      to.z += 1;
+      to = to.AtLayer(to.z() + 1);
     }
     if (!IsPieceMoveValid(state, from, to)) {
       continue;
     }
-    moves.emplace_back(from, to);
+    moves->emplace_back(from, to);
   }
-  return moves;
 }
 
-std::vector<Move> GetGrasshopperMovePositions(const HiveState& state, const Pos& from) {
-  CHECK(from.z == 0);
-  std::vector<Move> moves;
-  for (const std::pair<int, int>& direction : kAdjacentDirections) {
-    Pos to(from.x + direction.first, from.y + direction.second, from.z);
+void GetGrasshopperMovePositions(const HiveState& state, const Pos& from, MoveList* moves) {
+  CHECK(from.z() == 0);
+  for (int direction = 0; direction < 6; ++direction) {
+    Pos to = from.Adjacent(direction);
     if (state.IsEmpty(to)) {
       continue;
     }
     while (!state.IsEmpty(to)) {
-      to.x += direction.first;
-      to.y += direction.second;
+      to = to.Adjacent(direction);
     }
-    moves.emplace_back(from, to);
+    moves->emplace_back(from, to);
   }
-  return moves;
-}  // namespace hive
+}
 
-std::vector<Move> GetSpiderMovePositions(HiveState& state, const Pos& from) {
-  CHECK(from.z == 0);
-  std::unordered_set<Move> moves;
-  std::vector<Pos> history = {from};
-  // NOTE: need to remove here to for correct judgement under mutli-step movements.
-  Piece from_piece = state.pieces.at(from);
-  CHECK_EQ(state.pieces.erase(from), 1);
-  SpiderRecursiveMove(state, history, moves);
-  state.pieces[from] = from_piece;
-  return std::vector<Move>(moves.begin(), moves.end());
+void GetSpiderMovePositions(const HiveState& state, const Pos& from, MoveList* moves) {
+  CHECK(from.z() == 0);
+  PosList destinations;
+  GetPerimeterGraph(state, from).GetSlideDestinations(from, 3, &destinations);
+  AddMoves(from, destinations, moves);
 }
 
-std::vector<Move> GetAntMovePositions(HiveState& state, const Pos& from) {
+void GetAntMovePositions(const HiveState& state, const Pos& from, MoveList* moves) {
   // Ant is exactly like spider, but can move to anywhere that has depth > 1
-  CHECK(from.z == 0);
-  Piece from_piece = state.pieces.at(from);
-  CHECK_EQ(state.pieces.erase(from), 1);
-  std::unordered_set<Pos> visited;
-  std::deque<Pos> to_visit = {from};
-  while (!to_visit.empty()) {
-    Pos current_pos = to_visit.front();
-    to_visit.pop_front();
-    if (visited.find(current_pos) == visited.end()) {
-      visited.insert(current_pos);
-      for (const auto& to : current_pos.GetAdjacentPositions()) {
-        if (!state.IsEmpty(to) || visited.find(to) != visited.end() ||
-            !IsPieceMoveValid(state, current_pos, to)) {
-          continue;
-        }
-        to_visit.push_back(to);
-      }
-    }
-  }
-  visited.erase(from);
-  std::vector<Move> moves;
-  for (const auto& to : visited) {
-    moves.emplace_back(from, to);
-  }
-  state.pieces[from] = from_piece;
-  return moves;
+  CHECK(from.z() == 0);
+  PosList destinations;
+  GetPerimeterGraph(state, from).GetReachable(from, &destinations);
+  AddMoves(from, destinations, moves);
 }
 
-std::vector<Move> GetLadybugMovePositions(HiveState& state, const Pos& from) {
-  // Like spider, except that the first 2 moves must be at level 1.
-  CHECK(from.z == 0);
-  std::unordered_set<Move> moves;
-  std::vector<Pos> history = {from};
-  Piece from_piece = state.pieces.at(from);
-  CHECK_EQ(state.pieces.erase(from), 1);
-  LadybugRecursiveMove(state, history, moves);
-  state.pieces[from] = from_piece;
-  return std::vector<Move>(moves.begin(), moves.end());
+void GetLadybugMovePositions(const HiveState& state, const Pos& from, MoveList* moves) {
+  // Like spider, except that the first 2 moves must be on top of the hive.
+  CHECK(from.z() == 0);
+  PosList destinations;
+  GetPerimeterGraph(state, from).GetLadybugDestinations(from, &destinations);
+  AddMoves(from, destinations, moves);
 }
 
-std::vector<Move> GetMosquitoMovePositions(HiveState& state, const Pos& from) {
-  if (from.z > 0) {
-    return GetBeetleMovePositions(state, from);
+void GetMosquitoMovePositions(const HiveState& state, const Pos& from, MoveList* moves) {
+  if (from.z() > 0) {
+    return GetBeetleMovePositions(state, from, moves);
   }
-  std::unordered_set<PieceType> adjacent_piece_types;
-  for (const auto& pos : state.GetNeighbours(from)) {
-    adjacent_piece_types.insert(state.GetPieceType(pos));
+  // One bit per piece type next to the mosquito.
+  uint32_t adjacent_piece_types = 0;
+  uint8_t mask = state.GetNeighbourMask(from);
+  for (int direction = 0; direction < 6; ++direction) {
+    if ((mask >> direction) & 1) {
+      adjacent_piece_types |= 1u << static_cast<int>(state.GetPieceType(from.Adjacent(direction)));
+    }
   }
   // Ban itself.
-  adjacent_piece_types.erase(PieceType::kMosquito);
-  std::unordered_set<Move> moves;
-  for (PieceType type : adjacent_piece_types) {
-    std::vector<Move> move_for_type = GetMoveByType(state, from, type);
-    moves.insert(move_for_type.begin(), move_for_type.end());
+  adjacent_piece_types &= ~(1u << static_cast<int>(PieceType::kMosquito));
+  const int begin = moves->size();
+  for (int type = 0; adjacent_piece_types >> type != 0; ++type) {
+    if ((adjacent_piece_types >> type) & 1) {
+      GetMoveByType(state, from, static_cast<PieceType>(type), moves);
+    }
   }
-  return std::vector<Move>(moves.begin(), moves.end());
+  // Copied types overlap, e.g. queen and pillbug steps. The mosquito lands on each cell once;
+  // pillbug throws are only generated for one type and are all distinct.
+  Bitboard destinations;
+  int size = begin;
+  for (int i = begin; i < moves->size(); ++i) {
+    const Move& move = (*moves)[i];
+    if (!move.immobile_next_turn) {
+      int cell = CellIndex(move.to);
+      if (destinations.Test(cell)) {
+        continue;
+      }
+      destinations.Set(cell);
+    }
+    (*moves)[size++] = move;
+  }
+  moves->Truncate(size);
 }
 
-std::vector<Move> GetPillbugMovePositions(const HiveState& state, const Pos& from) {
-  CHECK(from.z == 0);
+void GetPillbugMovePositions(const HiveState& state, const Pos& from, MoveList* moves) {
+  CHECK(from.z() == 0);
   // Standard move same as a queen
-  std::vector<Move> moves = GetQueenMovePositions(state, from);
+  GetQueenMovePositions(state, from, moves);
   // Alternative movement
-  std::vector<Pos> empty_positions;
-  std::vector<Pos> ground_level_positions;
-  for (const auto& pos : from.GetAdjacentPositions()) {
+  FixedVector<Pos, 6> empty_positions;
+  FixedVector<Pos, 6> ground_level_positions;
+  for (const Pos& pos : from.GetAdjacentPositions()) {
     if (state.IsEmpty(pos)) {
       empty_positions.push_back(pos);
-    } else if (pos.z == 0) {
+    } else {
       ground_level_positions.push_back(pos);
     }
   }
   if (empty_positions.empty() || ground_level_positions.empty()) {  // early stop
-    return moves;
+    return;
   }
-  Pos over(from.x, from.y, 1);
+  Pos over = from.AtLayer(1);
   for (const auto& move_from : ground_level_positions) {
-    if (state.IsImmobile(move_from) || !IsHiveStillConnected(state, move_from) ||
+    if (state.IsStacked(move_from) || state.IsImmobile(move_from) ||
+        state.IsLastMoved(move_from) || !IsHiveStillConnected(state, move_from) ||
         !IsPieceMoveValid(state, move_from, over)) {
       // In those cases, the piece cannot be moved.
       continue;
@@ -256,69 +222,34 @@ std::vector<Move> GetPillbugMovePositions(const HiveState& state, const Pos& fro
       if (!IsPieceMoveValid(state, over, to)) {
         continue;
       }
-      moves.push_back({.from = move_from, .to = to, .immobile_next_turn = true});
+      moves->emplace_back(move_from, to, /*immobile_next_turn=*/true);
     }
   }
-  return moves;
 }
 
 bool IsHiveStillConnected(const HiveState& state, const Pos& from) {
-  if (from.z > 0) {  // If move on higher position, hive will always be connected.
+  if (from.z() > 0) {  // If move on higher position, hive will always be connected.
     return true;
   }
-  // Precondition: pos.z == 0
-  std::vector<Pos> neighbours = state.GetNeighbours(from);
-  CHECK_GT(neighbours.size(), 0);
-  if (neighbours.size() == 1 || neighbours.size() >= 5) {
+  // Neighbours touching each other in one run stay connected without the piece.
+  if (kNeighbourTable.single_run[state.GetNeighbourMask(from)]) {
     return true;
   }
-  // Just need to check if we can reach any neighbour from neighbour 0, given
-  // pos is ignored.
-  std::unordered_set<Pos> visited;
-  std::deque<Pos> to_be_visit = {neighbours[0]};
-  while (!to_be_visit.empty()) {
-    Pos current_pos = to_be_visit.front();
-    to_be_visit.pop_front();
-    if (visited.find(current_pos) == visited.end()) {
-      visited.insert(current_pos);
-      for (const auto& neighbour : state.GetNeighbours(current_pos)) {
-        if (visited.find(neighbour) == visited.end() && neighbour != from) {
-          to_be_visit.push_back(neighbour);
-        }
-      }
-    }
-  }
-  for (size_t i = 1; i < neighbours.size(); ++i) {
-    if (visited.find(neighbours[i]) == visited.end()) {
-      return false;
-    }
-  }
-  return true;
+  return !state.GetArticulationPoints().Test(CellIndex(from));
 }
 
 bool IsPieceMoveValid(const HiveState& state, const Pos& from, const Pos& to) {
+  int direction = GetDirection(from, to);
+  CHECK_GE(direction, 0) << "should not come here. From = " << from.DebugString()
+                         << ", To = " << to.DebugString();
   // If going up/down, only the highest level needs to be considered.
-  int check_z = std::max(from.z, to.z);
-  for (int i = 0; i < 6; ++i) {
-    if (to.x == from.x + kAdjacentDirections[i].first &&
-        to.y == from.y + kAdjacentDirections[i].second) {
-      int previous = (i + 5) % 6;
-      int next = (i + 1) % 6;
-      Pos previous_pos(from.x + kAdjacentDirections[previous].first,
-                       from.y + kAdjacentDirections[previous].second, check_z);
-      Pos next_pos(from.x + kAdjacentDirections[next].first,
-                   from.y + kAdjacentDirections[next].second, check_z);
-      if (check_z > 0) {
-        return state.IsEmpty(previous_pos) || state.IsEmpty(next_pos);
-      } else {
-        // Exactly one of the position should be occupied.
-        return state.IsEmpty(previous_pos) ^ state.IsEmpty(next_pos);
-      }
-    }
+  int check_z = std::max(from.z(), to.z());
+  uint8_t mask = state.GetNeighbourMask(from.AtLayer(check_z));
+  if (check_z > 0) {
+    return (kNeighbourTable.elevated_gates[mask] >> direction) & 1;
   }
-  LOG(FATAL) << "should not come here. From = " << from.DebugString()
-             << ", To = " << to.DebugString();
-  return false;
+  // Exactly one of the position should be occupied.
+  return (kNeighbourTable.ground_gates[mask] >> direction) & 1;
 }
 
 }  // namespace hive
@@ -326,12 +257,8 @@ bool IsPieceMoveValid(const HiveState& state, const Pos& from, const Pos& to) {
 namespace std {
 
 size_t hash<hive::Move>::operator()(const hive::Move& move) const {
-  std::size_t seed = 0;
-  std::hash<hive::Pos> pos_hasher;
-  boost::hash_combine(seed, pos_hasher(move.from));
-  boost::hash_combine(seed, pos_hasher(move.to));
-  boost::hash_combine(seed, move.immobile_next_turn);
-  return seed;
+  return static_cast<size_t>(move.from.key()) | static_cast<size_t>(move.to.key()) << 16 |
+         static_cast<size_t>(move.immobile_next_turn) << 32;
 }
 
-}  // namespace std
\ No newline at end of file
+}  // namespace std
@@ -1,7 +1,8 @@
+#pragma once
 
 #include <iostream>
-#include <vector>
 
+#include "backend/fixed_vector.h"
 #include "backend/state.h"
 
 namespace hive {
@@ -32,31 +33,43 @@ struct Move {
   };
 };
 
+// Upper bound of the moves in one position.
+constexpr int kMaxMoves = 1024;
+using MoveList = FixedVector<Move, kMaxMoves>;
+
+// The functions below append moves to `moves`, without any heap allocation.
+
 // Get available moves from current state
-std::vector<Move> GetMoveActions(HiveState& state);
+void GetMoveActions(const HiveState& state, MoveList* moves);
+
+// Pieces on top of their column that belong to the active player, in the order GetMoveActions()
+// generates their moves. Whether movement is allowed at all is not checked.
+using PieceList = FixedVector<Pos, kMaxPieces>;
+void GetMovablePieces(const HiveState& state, PieceList* pieces);
 
-// Given a State, and a piece by position, return the moves available.
-// For performance consideration, state could be mutated for multiple-step movements,
-// the function must guarantee that state is unchanged.
-std::vector<Move> GetMovePositions(HiveState& state, const Pos& from);
+// Given a State, and a piece by position, get the moves available.
+// Sliding pieces share one PerimeterGraph per board and thread, see GetPerimeterGraph().
+void GetMovePositions(const HiveState& state, const Pos& from, MoveList* moves);
 
 // Moves for different pieces.
-std::vector<Move> GetQueenMovePositions(const HiveState& state, const Pos& from);
-std::vector<Move> GetBeetleMovePositions(const HiveState& state, const Pos& from);
-std::vector<Move> GetGrasshopperMovePositions(const HiveState& state, const Pos& from);
-std::vector<Move> GetSpiderMovePositions(HiveState& state, const Pos& from);
-std::vector<Move> GetAntMovePositions(HiveState& state, const Pos& from);
-std::vector<Move> GetLadybugMovePositions(HiveState& state, const Pos& from);
-std::vector<Move> GetMosquitoMovePositions(HiveState& state, const Pos& from);
-std::vector<Move> GetPillbugMovePositions(const HiveState& state, const Pos& from);
+void GetQueenMovePositions(const HiveState& state, const Pos& from, MoveList* moves);
+void GetBeetleMovePositions(const HiveState& state, const Pos& from, MoveList* moves);
+void GetGrasshopperMovePositions(const HiveState& state, const Pos& from, MoveList* moves);
+void GetSpiderMovePositions(const HiveState& state, const Pos& from, MoveList* moves);
+void GetAntMovePositions(const HiveState& state, const Pos& from, MoveList* moves);
+void GetLadybugMovePositions(const HiveState& state, const Pos& from, MoveList* moves);
+void GetMosquitoMovePositions(const HiveState& state, const Pos& from, MoveList* moves);
+void GetPillbugMovePositions(const HiveState& state, const Pos& from, MoveList* moves);
 
 // === Helpers ===
 
 // For mosquito to share implementation
-std::vector<Move> GetMoveByType(HiveState& state, const Pos& from, PieceType piece_type);
+void GetMoveByType(const HiveState& state, const Pos& from, PieceType piece_type,
+                   MoveList* moves);
 
 // One hive rule part 1: hive connectivity.
 // Check if hive is still connected after "from" is removed.
+// O(1) after the first call on a board, see HiveState::GetArticulationPoints().
 bool IsHiveStillConnected(const HiveState& state, const Pos& from);
 
 // Check if the one step move for a piece is valid, including:
@@ -0,0 +1,125 @@
+#include "backend/action.h"
+#include "backend/benchmark_util.h"
+#include "backend/moves.h"
+#include "backend/state.h"
+#include "benchmark/benchmark.h"
+
+namespace hive {
+namespace {
+
+using MoveFunction = void (*)(const HiveState&, const Pos&, MoveList*);
+
+// The same board under other keys: the other side to move and one spare piece less.
+// Alternating the two makes every call recompute the per-thread PerimeterGraph and articulation
+// points, as on a new node of the search.
+HiveState Twin(const HiveState& state) {
+  HiveState twin(state);
+  twin.active_player = state.active_player == Side::kBlack ? Side::kWhite : Side::kBlack;
+  for (PieceType type : {PieceType::kQueen, PieceType::kBeetle, PieceType::kGrasshopper,
+                         PieceType::kSpider, PieceType::kAnt, PieceType::kLadybug,
+                         PieceType::kMosquito, PieceType::kPillbug}) {
+    for (Side side : {Side::kBlack, Side::kWhite}) {
+      if (twin.GetPieceCount(side, type) > 0) {
+        twin.SetPieceCount(side, type, twin.GetPieceCount(side, type) - 1);
+        return twin;
+      }
+    }
+  }
+  return twin;
+}
+
+// Pieces of a type that move generation would consider: on top of their column and, on the
+// ground, not holding the hive together.
+PieceList GetPieces(const HiveState& state, PieceType type) {
+  PieceList pieces;
+  state.ForEachPiece([&](const Pos& pos, const Piece& piece) {
+    if (piece.type == type && !state.IsStacked(pos) &&
+        (pos.z() > 0 || IsHiveStillConnected(state, pos))) {
+      pieces.push_back(pos);
+    }
+  });
+  return pieces;
+}
+
+// Moves of every movable piece of a type. Items are pieces.
+void BM_PieceMoves(benchmark::State& bench_state, PieceType type, MoveFunction get_moves) {
+  const HiveState states[2] = {GetCorpusPosition(bench_state.range(0)),
+                               Twin(GetCorpusPosition(bench_state.range(0)))};
+  const PieceList pieces = GetPieces(states[0], type);
+  if (pieces.empty()) {
+    bench_state.SkipWithError("No such piece in this position");
+    return;
+  }
+  MoveList moves;
+  int turn = 0;
+  const int64_t num_allocations = GetNumAllocations();
+  for (auto _ : bench_state) {
+    const HiveState& state = states[turn ^= 1];
+    for (const Pos& pos : pieces) {
+      moves.clear();
+      get_moves(state, pos, &moves);
+      benchmark::DoNotOptimize(moves.size());
+    }
+  }
+  ReportCounters(bench_state, num_allocations, bench_state.iterations() * pieces.size());
+}
+BENCHMARK_CAPTURE(BM_PieceMoves, queen, PieceType::kQueen, &GetQueenMovePositions)
+    ->DenseRange(0, kNumCorpusPositions - 1);
+BENCHMARK_CAPTURE(BM_PieceMoves, beetle, PieceType::kBeetle, &GetBeetleMovePositions)
+    ->DenseRange(0, kNumCorpusPositions - 1);
+BENCHMARK_CAPTURE(BM_PieceMoves, grasshopper, PieceType::kGrasshopper,
+                  &GetGrasshopperMovePositions)
+    ->DenseRange(0, kNumCorpusPositions - 1);
+BENCHMARK_CAPTURE(BM_PieceMoves, spider, PieceType::kSpider, &GetSpiderMovePositions)
+    ->DenseRange(0, kNumCorpusPositions - 1);
+BENCHMARK_CAPTURE(BM_PieceMoves, ant, PieceType::kAnt, &GetAntMovePositions)
+    ->DenseRange(0, kNumCorpusPositions - 1);
+BENCHMARK_CAPTURE(BM_PieceMoves, ladybug, PieceType::kLadybug, &GetLadybugMovePositions)
+    ->DenseRange(0, kNumCorpusPositions - 1);
+BENCHMARK_CAPTURE(BM_PieceMoves, mosquito, PieceType::kMosquito, &GetMosquitoMovePositions)
+    ->DenseRange(0, kNumCorpusPositions - 1);
+BENCHMARK_CAPTURE(BM_PieceMoves, pillbug, PieceType::kPillbug, &GetPillbugMovePositions)
+    ->DenseRange(0, kNumCorpusPositions - 1);
+
+// Connectivity of every ground piece, the articulation points being computed once per call.
+// Items are pieces.
+void BM_IsHiveStillConnected(benchmark::State& bench_state) {
+  const HiveState states[2] = {GetCorpusPosition(bench_state.range(0)),
+                               Twin(GetCorpusPosition(bench_state.range(0)))};
+  PieceList pieces;
+  states[0].ForEachPiece([&](const Pos& pos, const Piece&) {
+    if (pos.z() == 0) {
+      pieces.push_back(pos);
+    }
+  });
+  int turn = 0;
+  const int64_t num_allocations = GetNumAllocations();
+  for (auto _ : bench_state) {
+    const HiveState& state = states[turn ^= 1];
+    for (const Pos& pos : pieces) {
+      benchmark::DoNotOptimize(IsHiveStillConnected(state, pos));
+    }
+  }
+  ReportCounters(bench_state, num_allocations, bench_state.iterations() * pieces.size());
+}
+BENCHMARK(BM_IsHiveStillConnected)->DenseRange(0, kNumCorpusPositions - 1);
+
+// All the actions of a position, as every expansion needs. Items are actions.
+void BM_GetActionsForBoard(benchmark::State& bench_state) {
+  const HiveState states[2] = {GetCorpusPosition(bench_state.range(0)),
+                               Twin(GetCorpusPosition(bench_state.range(0)))};
+  ActionList actions;
+  int64_t num_actions = 0;
+  int turn = 0;
+  const int64_t num_allocations = GetNumAllocations();
+  for (auto _ : bench_state) {
+    actions.clear();
+    GetActionsForBoard(states[turn ^= 1], &actions);
+    num_actions += actions.size();
+  }
+  ReportCounters(bench_state, num_allocations, num_actions);
+}
+BENCHMARK(BM_GetActionsForBoard)->DenseRange(0, kNumCorpusPositions - 1);
+
+}  // namespace
+}  // namespace hive
@@ -7,6 +7,16 @@
 
 using namespace hive;
 
+namespace {
+
+MoveList GetMoves(const HiveState& state, const Pos& from) {
+  MoveList moves;
+  GetMovePositions(state, from, &moves);
+  return moves;
+}
+
+}  // namespace
+
 // Test samples are constructed according to official ruling book examples.
 
 TEST(MovesTest, IsHiveStillConnected) {
@@ -17,11 +27,11 @@ TEST(MovesTest, IsHiveStillConnected) {
    *  +-------+
    */
   HiveState state;
-  state.pieces[Pos(0, 0)] = Piece(PieceType::kAnt, Side::kBlack);
-  state.pieces[Pos(1, 0)] = Piece(PieceType::kBeetle, Side::kBlack);
-  state.pieces[Pos(2, 0)] = Piece(PieceType::kQueen, Side::kWhite);
-  state.pieces[Pos(-1, 0)] = Piece(PieceType::kQueen, Side::kBlack);
-  state.pieces[Pos(0, -1)] = Piece(PieceType::kAnt, Side::kWhite);
+  state.PutPiece(Pos(0, 0), Piece(PieceType::kAnt, Side::kBlack));
+  state.PutPiece(Pos(1, 0), Piece(PieceType::kBeetle, Side::kBlack));
+  state.PutPiece(Pos(2, 0), Piece(PieceType::kQueen, Side::kWhite));
+  state.PutPiece(Pos(-1, 0), Piece(PieceType::kQueen, Side::kBlack));
+  state.PutPiece(Pos(0, -1), Piece(PieceType::kAnt, Side::kWhite));
   EXPECT_EQ(IsHiveStillConnected(state, Pos(0, 0)), false);
   EXPECT_EQ(IsHiveStillConnected(state, Pos(1, 0)), false);
   EXPECT_EQ(IsHiveStillConnected(state, Pos(2, 0)), true);
@@ -39,41 +49,41 @@ TEST(MovesTest, PieceMoveValid) {
      *  +-----+
      */
     HiveState state;
-    state.pieces[Pos(0, 0)] = Piece(PieceType::kAnt, Side::kBlack);
-    state.pieces[Pos(1, 0)] = Piece(PieceType::kSpider, Side::kWhite);
-    state.pieces[Pos(0, 1)] = Piece(PieceType::kQueen, Side::kWhite);
-    state.pieces[Pos(-1, 1)] = Piece(PieceType::kBeetle, Side::kWhite);
-    state.pieces[Pos(-1, 0)] = Piece(PieceType::kQueen, Side::kBlack);
-    state.pieces[Pos(0, -1)] = Piece(PieceType::kAnt, Side::kWhite);
+    state.PutPiece(Pos(0, 0), Piece(PieceType::kAnt, Side::kBlack));
+    state.PutPiece(Pos(1, 0), Piece(PieceType::kSpider, Side::kWhite));
+    state.PutPiece(Pos(0, 1), Piece(PieceType::kQueen, Side::kWhite));
+    state.PutPiece(Pos(-1, 1), Piece(PieceType::kBeetle, Side::kWhite));
+    state.PutPiece(Pos(-1, 0), Piece(PieceType::kQueen, Side::kBlack));
+    state.PutPiece(Pos(0, -1), Piece(PieceType::kAnt, Side::kWhite));
     EXPECT_EQ(IsPieceMoveValid(state, Pos(0, 0), Pos(1, -1)), false);
-    state.pieces.erase(Pos(0, -1));
+    state.RemovePiece(Pos(0, -1));
     EXPECT_EQ(IsPieceMoveValid(state, Pos(0, 0), Pos(1, -1)), true);
-    state.pieces.erase(Pos(-1, 0));
+    state.RemovePiece(Pos(-1, 0));
     EXPECT_EQ(IsPieceMoveValid(state, Pos(0, 0), Pos(1, -1)), true);
     EXPECT_EQ(IsPieceMoveValid(state, Pos(0, 0), Pos(0, -1)), false);
   }
 
   {  // Corner case for beetle. Add a beetle above.
     HiveState state;
-    state.pieces[Pos(0, 0)] = Piece(PieceType::kAnt, Side::kBlack);
-    state.pieces[Pos(0, 0, 1)] = Piece(PieceType::kBeetle, Side::kBlack);
-    state.pieces[Pos(1, 0)] = Piece(PieceType::kSpider, Side::kWhite);
-    state.pieces[Pos(0, 1)] = Piece(PieceType::kQueen, Side::kWhite);
-    state.pieces[Pos(-1, 1)] = Piece(PieceType::kBeetle, Side::kWhite);
-    state.pieces[Pos(-1, 0)] = Piece(PieceType::kQueen, Side::kBlack);
-    state.pieces[Pos(0, -1)] = Piece(PieceType::kAnt, Side::kWhite);
+    state.PutPiece(Pos(0, 0), Piece(PieceType::kAnt, Side::kBlack));
+    state.PutPiece(Pos(0, 0, 1), Piece(PieceType::kBeetle, Side::kBlack));
+    state.PutPiece(Pos(1, 0), Piece(PieceType::kSpider, Side::kWhite));
+    state.PutPiece(Pos(0, 1), Piece(PieceType::kQueen, Side::kWhite));
+    state.PutPiece(Pos(-1, 1), Piece(PieceType::kBeetle, Side::kWhite));
+    state.PutPiece(Pos(-1, 0), Piece(PieceType::kQueen, Side::kBlack));
+    state.PutPiece(Pos(0, -1), Piece(PieceType::kAnt, Side::kWhite));
     EXPECT_EQ(IsPieceMoveValid(state, Pos(0, 0, 1), Pos(1, -1)), true);
-    state.pieces[Pos(1, 0, 1)] = Piece(PieceType::kMosquito, Side::kWhite);
-    state.pieces[Pos(0, -1, 1)] = Piece(PieceType::kMosquito, Side::kBlack);
+    state.PutPiece(Pos(1, 0, 1), Piece(PieceType::kMosquito, Side::kWhite));
+    state.PutPiece(Pos(0, -1, 1), Piece(PieceType::kMosquito, Side::kBlack));
     EXPECT_EQ(IsPieceMoveValid(state, Pos(0, 0, 1), Pos(1, -1)), false);  // Blocked.
   }
   {  // Corner case from ruling
     HiveState state;
-    state.pieces[Pos(1, 0)] = Piece(PieceType::kSpider, Side::kWhite);
-    state.pieces[Pos(0, 1)] = Piece(PieceType::kQueen, Side::kWhite);
-    state.pieces[Pos(-1, 1)] = Piece(PieceType::kBeetle, Side::kWhite);
-    state.pieces[Pos(-1, 0)] = Piece(PieceType::kQueen, Side::kBlack);
-    state.pieces[Pos(0, -1)] = Piece(PieceType::kAnt, Side::kWhite);
+    state.PutPiece(Pos(1, 0), Piece(PieceType::kSpider, Side::kWhite));
+    state.PutPiece(Pos(0, 1), Piece(PieceType::kQueen, Side::kWhite));
+    state.PutPiece(Pos(-1, 1), Piece(PieceType::kBeetle, Side::kWhite));
+    state.PutPiece(Pos(-1, 0), Piece(PieceType::kQueen, Side::kBlack));
+    state.PutPiece(Pos(0, -1), Piece(PieceType::kAnt, Side::kWhite));
     EXPECT_EQ(IsPieceMoveValid(state, Pos(1, 0), Pos(1, -1)),
               false);  // Cannot move since temporary disconnect from hive
   }
@@ -90,19 +100,19 @@ TEST(MovesTest, Queen) {
    * +------+
    */
   HiveState state;
-  state.pieces[Pos(-1, 0)] = Piece(PieceType::kQueen, Side::kBlack);
-  state.pieces[Pos(-1, 1)] = Piece(PieceType::kAnt, Side::kBlack);
-  state.pieces[Pos(-1, 2)] = Piece(PieceType::kSpider, Side::kWhite);
-  state.pieces[Pos(0, 1)] = Piece(PieceType::kSpider, Side::kBlack);
-  state.pieces[Pos(1, 0)] = Piece(PieceType::kBeetle, Side::kWhite);
-  state.pieces[Pos(1, -1)] = Piece(PieceType::kBeetle, Side::kBlack);
-  state.pieces[Pos(1, -2)] = Piece(PieceType::kAnt, Side::kWhite);
-  state.pieces[Pos(2, -2)] = Piece(PieceType::kQueen, Side::kWhite);
-  state.pieces[Pos(-1, -1)] = Piece(PieceType::kGrasshopper, Side::kWhite);
-  state.pieces[Pos(0, -2)] = Piece(PieceType::kGrasshopper, Side::kBlack);
+  state.PutPiece(Pos(-1, 0), Piece(PieceType::kQueen, Side::kBlack));
+  state.PutPiece(Pos(-1, 1), Piece(PieceType::kAnt, Side::kBlack));
+  state.PutPiece(Pos(-1, 2), Piece(PieceType::kSpider, Side::kWhite));
+  state.PutPiece(Pos(0, 1), Piece(PieceType::kSpider, Side::kBlack));
+  state.PutPiece(Pos(1, 0), Piece(PieceType::kBeetle, Side::kWhite));
+  state.PutPiece(Pos(1, -1), Piece(PieceType::kBeetle, Side::kBlack));
+  state.PutPiece(Pos(1, -2), Piece(PieceType::kAnt, Side::kWhite));
+  state.PutPiece(Pos(2, -2), Piece(PieceType::kQueen, Side::kWhite));
+  state.PutPiece(Pos(-1, -1), Piece(PieceType::kGrasshopper, Side::kWhite));
+  state.PutPiece(Pos(0, -2), Piece(PieceType::kGrasshopper, Side::kBlack));
 
   Pos from(-1, 0);
-  ASSERT_THAT(GetMovePositions(state, Pos(-1, 0)),
+  ASSERT_THAT(GetMoves(state, Pos(-1, 0)),
               testing::UnorderedElementsAre(Move(from, Pos(0, 0)), Move(from, Pos(0, -1)),
                                             Move(from, Pos(-2, 1)), Move(from, Pos(-2, 0))));
 }
@@ -115,13 +125,13 @@ TEST(MovesTest, Beetle) {
    * +------+
    */
   HiveState state;
-  state.pieces[Pos(0, 0)] = Piece(PieceType::kBeetle, Side::kWhite);
-  state.pieces[Pos(0, -1)] = Piece(PieceType::kSpider, Side::kBlack);
-  state.pieces[Pos(1, -1)] = Piece(PieceType::kAnt, Side::kBlack);
-  state.pieces[Pos(2, -1)] = Piece(PieceType::kQueen, Side::kWhite);
-  state.pieces[Pos(2, 0)] = Piece(PieceType::kGrasshopper, Side::kWhite);
+  state.PutPiece(Pos(0, 0), Piece(PieceType::kBeetle, Side::kWhite));
+  state.PutPiece(Pos(0, -1), Piece(PieceType::kSpider, Side::kBlack));
+  state.PutPiece(Pos(1, -1), Piece(PieceType::kAnt, Side::kBlack));
+  state.PutPiece(Pos(2, -1), Piece(PieceType::kQueen, Side::kWhite));
+  state.PutPiece(Pos(2, 0), Piece(PieceType::kGrasshopper, Side::kWhite));
   Pos from(0, 0);
-  ASSERT_THAT(GetMovePositions(state, Pos(0, 0)),
+  ASSERT_THAT(GetMoves(state, Pos(0, 0)),
               testing::UnorderedElementsAre(Move(from, Pos(-1, 0)), Move(from, Pos(1, 0)),
                                             Move(from, Pos(0, -1, 1)), Move(from, Pos(1, -1, 1))));
 }
@@ -136,19 +146,19 @@ TEST(MovesTest, Grasshopper) {
    * +----------+
    */
   HiveState state;
-  state.pieces[Pos(0, 0)] = Piece(PieceType::kGrasshopper, Side::kWhite);
-  state.pieces[Pos(1, 0)] = Piece(PieceType::kAnt, Side::kBlack);
-  state.pieces[Pos(2, 0)] = Piece(PieceType::kAnt, Side::kBlack);
-  state.pieces[Pos(4, 0)] = Piece(PieceType::kAnt, Side::kBlack);
-  state.pieces[Pos(1, 1)] = Piece(PieceType::kAnt, Side::kBlack);
-  state.pieces[Pos(2, 1)] = Piece(PieceType::kAnt, Side::kBlack);
-  state.pieces[Pos(3, 1)] = Piece(PieceType::kAnt, Side::kBlack);
-  state.pieces[Pos(0, 2)] = Piece(PieceType::kAnt, Side::kBlack);
-  state.pieces[Pos(-1, 2)] = Piece(PieceType::kAnt, Side::kBlack);
-  state.pieces[Pos(-1, 1)] = Piece(PieceType::kAnt, Side::kBlack);
-  state.pieces[Pos(1, -1)] = Piece(PieceType::kAnt, Side::kBlack);
+  state.PutPiece(Pos(0, 0), Piece(PieceType::kGrasshopper, Side::kWhite));
+  state.PutPiece(Pos(1, 0), Piece(PieceType::kAnt, Side::kBlack));
+  state.PutPiece(Pos(2, 0), Piece(PieceType::kAnt, Side::kBlack));
+  state.PutPiece(Pos(4, 0), Piece(PieceType::kAnt, Side::kBlack));
+  state.PutPiece(Pos(1, 1), Piece(PieceType::kAnt, Side::kBlack));
+  state.PutPiece(Pos(2, 1), Piece(PieceType::kAnt, Side::kBlack));
+  state.PutPiece(Pos(3, 1), Piece(PieceType::kAnt, Side::kBlack));
+  state.PutPiece(Pos(0, 2), Piece(PieceType::kAnt, Side::kBlack));
+  state.PutPiece(Pos(-1, 2), Piece(PieceType::kAnt, Side::kBlack));
+  state.PutPiece(Pos(-1, 1), Piece(PieceType::kAnt, Side::kBlack));
+  state.PutPiece(Pos(1, -1), Piece(PieceType::kAnt, Side::kBlack));
   Pos from(0, 0);
-  ASSERT_THAT(GetMovePositions(state, Pos(0, 0)),
+  ASSERT_THAT(GetMoves(state, Pos(0, 0)),
               testing::UnorderedElementsAre(Move(from, Pos(3, 0)), Move(from, Pos(2, -2)),
                                             Move(from, Pos(-2, 2))));
 }
@@ -164,20 +174,18 @@ TEST(MovesTest, Spider) {
    * +--------+
    */
   HiveState state;
-  state.pieces[Pos(0, 2)] = Piece(PieceType::kSpider, Side::kWhite);
-  state.pieces[Pos(1, 1)] = Piece(PieceType::kAnt, Side::kBlack);
-  state.pieces[Pos(2, 0)] = Piece(PieceType::kAnt, Side::kBlack);
-  state.pieces[Pos(2, -1)] = Piece(PieceType::kAnt, Side::kBlack);
-  state.pieces[Pos(1, 1)] = Piece(PieceType::kAnt, Side::kBlack);
-  state.pieces[Pos(2, -1)] = Piece(PieceType::kAnt, Side::kBlack);
-  state.pieces[Pos(2, -2)] = Piece(PieceType::kAnt, Side::kBlack);
-  state.pieces[Pos(1, -2)] = Piece(PieceType::kAnt, Side::kBlack);
-  state.pieces[Pos(0, -2)] = Piece(PieceType::kAnt, Side::kBlack);
-  state.pieces[Pos(-1, -1)] = Piece(PieceType::kAnt, Side::kBlack);
-  state.pieces[Pos(-1, 0)] = Piece(PieceType::kAnt, Side::kBlack);
-  state.pieces[Pos(-1, 1)] = Piece(PieceType::kAnt, Side::kBlack);
+  state.PutPiece(Pos(0, 2), Piece(PieceType::kSpider, Side::kWhite));
+  state.PutPiece(Pos(1, 1), Piece(PieceType::kAnt, Side::kBlack));
+  state.PutPiece(Pos(2, 0), Piece(PieceType::kAnt, Side::kBlack));
+  state.PutPiece(Pos(2, -1), Piece(PieceType::kAnt, Side::kBlack));
+  state.PutPiece(Pos(2, -2), Piece(PieceType::kAnt, Side::kBlack));
+  state.PutPiece(Pos(1, -2), Piece(PieceType::kAnt, Side::kBlack));
+  state.PutPiece(Pos(0, -2), Piece(PieceType::kAnt, Side::kBlack));
+  state.PutPiece(Pos(-1, -1), Piece(PieceType::kAnt, Side::kBlack));
+  state.PutPiece(Pos(-1, 0), Piece(PieceType::kAnt, Side::kBlack));
+  state.PutPiece(Pos(-1, 1), Piece(PieceType::kAnt, Side::kBlack));
   Pos from(0, 2);
-  ASSERT_THAT(GetMovePositions(state, Pos(0, 2)),
+  ASSERT_THAT(GetMoves(state, Pos(0, 2)),
               testing::UnorderedElementsAre(Move(from, Pos(3, 0)), Move(from, Pos(0, -1)),
                                             Move(from, Pos(1, -1)), Move(from, Pos(-2, 2))));
 }
@@ -192,14 +200,14 @@ TEST(MovesTest, Ant) {
    * +-----+
    */
   HiveState state;
-  state.pieces[Pos(1, -2)] = Piece(PieceType::kAnt, Side::kWhite);
-  state.pieces[Pos(0, -1)] = Piece(PieceType::kAnt, Side::kBlack);
-  state.pieces[Pos(1, -1)] = Piece(PieceType::kAnt, Side::kBlack);
-  state.pieces[Pos(-1, 0)] = Piece(PieceType::kAnt, Side::kBlack);
-  state.pieces[Pos(-1, 1)] = Piece(PieceType::kAnt, Side::kBlack);
-  state.pieces[Pos(1, 0)] = Piece(PieceType::kAnt, Side::kBlack);
+  state.PutPiece(Pos(1, -2), Piece(PieceType::kAnt, Side::kWhite));
+  state.PutPiece(Pos(0, -1), Piece(PieceType::kAnt, Side::kBlack));
+  state.PutPiece(Pos(1, -1), Piece(PieceType::kAnt, Side::kBlack));
+  state.PutPiece(Pos(-1, 0), Piece(PieceType::kAnt, Side::kBlack));
+  state.PutPiece(Pos(-1, 1), Piece(PieceType::kAnt, Side::kBlack));
+  state.PutPiece(Pos(1, 0), Piece(PieceType::kAnt, Side::kBlack));
   Pos from(1, -2);
-  ASSERT_THAT(GetMovePositions(state, Pos(1, -2)),
+  ASSERT_THAT(GetMoves(state, Pos(1, -2)),
               testing::UnorderedElementsAre(
                   Move(from, Pos(0, -2)), Move(from, Pos(-1, -1)), Move(from, Pos(-2, 0)),
                   Move(from, Pos(-2, 1)), Move(from, Pos(-2, 2)), Move(from, Pos(-1, 2)),
@@ -217,14 +225,14 @@ TEST(MovesTest, Ladybug) {
    * +-----+
    */
   HiveState state;
-  state.pieces[Pos(1, -2)] = Piece(PieceType::kLadybug, Side::kWhite);
-  state.pieces[Pos(0, -1)] = Piece(PieceType::kAnt, Side::kBlack);
-  state.pieces[Pos(1, -1)] = Piece(PieceType::kAnt, Side::kBlack);
-  state.pieces[Pos(-1, 0)] = Piece(PieceType::kAnt, Side::kBlack);
-  state.pieces[Pos(-1, 1)] = Piece(PieceType::kAnt, Side::kBlack);
-  state.pieces[Pos(1, 0)] = Piece(PieceType::kAnt, Side::kBlack);
+  state.PutPiece(Pos(1, -2), Piece(PieceType::kLadybug, Side::kWhite));
+  state.PutPiece(Pos(0, -1), Piece(PieceType::kAnt, Side::kBlack));
+  state.PutPiece(Pos(1, -1), Piece(PieceType::kAnt, Side::kBlack));
+  state.PutPiece(Pos(-1, 0), Piece(PieceType::kAnt, Side::kBlack));
+  state.PutPiece(Pos(-1, 1), Piece(PieceType::kAnt, Side::kBlack));
+  state.PutPiece(Pos(1, 0), Piece(PieceType::kAnt, Side::kBlack));
   Pos from(1, -2);
-  ASSERT_THAT(GetMovePositions(state, Pos(1, -2)),
+  ASSERT_THAT(GetMoves(state, Pos(1, -2)),
               testing::UnorderedElementsAre(Move(from, Pos(0, -2)), Move(from, Pos(-1, -1)),
                                             Move(from, Pos(-2, 0)), Move(from, Pos(-2, 1)),
                                             Move(from, Pos(0, 0)), Move(from, Pos(0, 1)),
@@ -242,14 +250,14 @@ TEST(MovesTest, Mosquito) {
    */
 
   HiveState state;
-  state.pieces[Pos(0, 0)] = Piece(PieceType::kBeetle, Side::kWhite);
-  state.pieces[Pos(0, -1)] = Piece(PieceType::kMosquito, Side::kWhite);
-  state.pieces[Pos(-1, 0)] = Piece(PieceType::kSpider, Side::kBlack);
-  state.pieces[Pos(1, 0)] = Piece(PieceType::kQueen, Side::kWhite);
-  state.pieces[Pos(0, 1)] = Piece(PieceType::kQueen, Side::kBlack);
+  state.PutPiece(Pos(0, 0), Piece(PieceType::kBeetle, Side::kWhite));
+  state.PutPiece(Pos(0, -1), Piece(PieceType::kMosquito, Side::kWhite));
+  state.PutPiece(Pos(-1, 0), Piece(PieceType::kSpider, Side::kBlack));
+  state.PutPiece(Pos(1, 0), Piece(PieceType::kQueen, Side::kWhite));
+  state.PutPiece(Pos(0, 1), Piece(PieceType::kQueen, Side::kBlack));
   Pos from(0, -1);
 
-  ASSERT_THAT(GetMovePositions(state, Pos(0, -1)),
+  ASSERT_THAT(GetMoves(state, Pos(0, -1)),
               testing::UnorderedElementsAre(Move(from, Pos(0, 0, 1)), Move(from, Pos(1, -1)),
                                             Move(from, Pos(-1, -1)), Move(from, Pos(-2, 1)),
                                             Move(from, Pos(-1, 0, 1)), Move(from, Pos(2, 0))));
@@ -264,14 +272,14 @@ TEST(MovesTest, Pillbug) {
    * +------+
    */
   HiveState state;
-  state.pieces[Pos(0, 0)] = Piece(PieceType::kPillbug, Side::kWhite);
-  state.pieces[Pos(0, 1)] = Piece(PieceType::kAnt, Side::kBlack);
-  state.pieces[Pos(-1, 1)] = Piece(PieceType::kAnt, Side::kBlack);
-  state.pieces[Pos(-1, 0)] = Piece(PieceType::kAnt, Side::kBlack);
-  state.pieces[Pos(0, -1)] = Piece(PieceType::kAnt, Side::kBlack);
-  state.pieces[Pos(-2, 0)] = Piece(PieceType::kAnt, Side::kBlack);
+  state.PutPiece(Pos(0, 0), Piece(PieceType::kPillbug, Side::kWhite));
+  state.PutPiece(Pos(0, 1), Piece(PieceType::kAnt, Side::kBlack));
+  state.PutPiece(Pos(-1, 1), Piece(PieceType::kAnt, Side::kBlack));
+  state.PutPiece(Pos(-1, 0), Piece(PieceType::kAnt, Side::kBlack));
+  state.PutPiece(Pos(0, -1), Piece(PieceType::kAnt, Side::kBlack));
+  state.PutPiece(Pos(-2, 0), Piece(PieceType::kAnt, Side::kBlack));
   Pos from(0, 0);
-  ASSERT_THAT(GetMovePositions(state, Pos(0, 0)),
+  ASSERT_THAT(GetMoves(state, Pos(0, 0)),
               testing::UnorderedElementsAre(
                   Move(from, Pos(1, 0)), Move(from, Pos(1, -1)), Move(Pos(0, 1), Pos(1, 0), true),
                   Move(Pos(0, 1), Pos(1, -1), true), Move(Pos(-1, 1), Pos(1, 0), true),
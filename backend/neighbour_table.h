@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+
+namespace hive {
+
+// Lookup tables indexed by a neighbour mask: bit d of the mask is set when the cell next to a
+// piece in kAdjacentDirections[d] is occupied. Directions are ordered in a circle, so d - 1 and
+// d + 1 are the two cells a piece squeezes between when leaving in direction d.
+struct NeighbourTable {
+  // Directions in which a piece on the ground keeps touching the hive without squeezing through a
+  // gate: exactly one of the two cells beside the way is occupied.
+  uint8_t ground_gates[64] = {};
+  // Directions in which a piece above the ground is not blocked: at most one of the two cells
+  // beside the way is occupied at that level.
+  uint8_t elevated_gates[64] = {};
+  // If the occupied neighbours form at most one contiguous run around the piece, in which case
+  // they stay connected to each other when the piece leaves.
+  bool single_run[64] = {};
+};
+
+constexpr NeighbourTable MakeNeighbourTable() {
+  NeighbourTable table;
+  for (int mask = 0; mask < 64; ++mask) {
+    int runs = 0;
+    for (int d = 0; d < 6; ++d) {
+      bool previous = (mask >> ((d + 5) % 6)) & 1;
+      bool next = (mask >> ((d + 1) % 6)) & 1;
+      if (previous != next) {
+        table.ground_gates[mask] |= 1 << d;
+      }
+      if (!(previous && next)) {
+        table.elevated_gates[mask] |= 1 << d;
+      }
+      // Count the starts of runs of occupied cells.
+      if (((mask >> d) & 1) && !previous) {
+        ++runs;
+      }
+    }
+    table.single_run[mask] = runs <= 1;
+  }
+  return table;
+}
+
+constexpr NeighbourTable kNeighbourTable = MakeNeighbourTable();
+
+// Directions an empty-destination slide on the ground may take.
+constexpr uint8_t GroundSlides(uint8_t mask) { return kNeighbourTable.ground_gates[mask] & ~mask; }
+
+}  // namespace hive
@@ -0,0 +1,27 @@
+#include "backend/neighbour_table.h"
+
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+using namespace hive;
+
+TEST(NeighbourTableTest, Gates) {
+  // Only direction 1 occupied: sliding to 0 or 2 keeps contact.
+  EXPECT_EQ(kNeighbourTable.ground_gates[0b000010], 0b000101);
+  EXPECT_EQ(GroundSlides(0b000010), 0b000101);
+  // Directions 0 and 2 occupied: direction 1 is a gate, too narrow to pass.
+  EXPECT_EQ(GroundSlides(0b000101), 0b101000);
+  EXPECT_EQ(kNeighbourTable.elevated_gates[0b000101] & 0b000010, 0);
+  EXPECT_EQ(kNeighbourTable.elevated_gates[0], 0b111111);
+  // Surrounded: nowhere to go.
+  EXPECT_EQ(GroundSlides(0b111111), 0);
+}
+
+TEST(NeighbourTableTest, SingleRun) {
+  EXPECT_TRUE(kNeighbourTable.single_run[0]);
+  EXPECT_TRUE(kNeighbourTable.single_run[0b000001]);
+  EXPECT_TRUE(kNeighbourTable.single_run[0b100001]);  // Runs wrap around.
+  EXPECT_TRUE(kNeighbourTable.single_run[0b111111]);
+  EXPECT_FALSE(kNeighbourTable.single_run[0b000101]);
+  EXPECT_FALSE(kNeighbourTable.single_run[0b011011]);
+}
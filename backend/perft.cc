@@ -0,0 +1,61 @@
+#include "backend/perft.h"
+
+#include <atomic>
+#include <thread>
+
+#include "glog/logging.h"
+
+namespace hive {
+
+uint64_t Perft(HiveState* state, int depth) {
+  if (depth == 0 || state->GetResult() != GameResult::kOngoing) {
+    return 1;
+  }
+  ActionList actions;
+  GetActionsForBoard(*state, &actions);
+  if (depth == 1) {
+    return actions.size();
+  }
+  uint64_t nodes = 0;
+  for (const HiveAction& action : actions) {
+    UndoRecord record;
+    action.execute(state, &record);
+    nodes += Perft(state, depth - 1);
+    action.undo(state, record);
+  }
+  return nodes;
+}
+
+std::vector<PerftEntry> PerftDivide(const HiveState& state, int depth, int num_threads) {
+  CHECK_GE(depth, 1);
+  CHECK_GE(num_threads, 1);
+  ActionList actions;
+  GetActionsForBoard(state, &actions);
+  std::vector<PerftEntry> entries(actions.size());
+  for (int i = 0; i < actions.size(); ++i) {
+    entries[i].action = actions[i];
+  }
+
+  // Subtrees differ a lot in size, so threads take the next root action when they are done.
+  std::atomic<int> next{0};
+  auto work = [&]() {
+    HiveState copy(state);
+    for (int i = next++; i < static_cast<int>(entries.size()); i = next++) {
+      UndoRecord record;
+      entries[i].action.execute(&copy, &record);
+      entries[i].nodes = Perft(&copy, depth - 1);
+      entries[i].action.undo(&copy, record);
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int i = 1; i < num_threads; ++i) {
+    threads.emplace_back(work);
+  }
+  work();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  return entries;
+}
+
+}  // namespace hive
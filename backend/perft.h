@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "backend/action.h"
+#include "backend/state.h"
+
+namespace hive {
+
+// Number of leaf positions depth plies below state, the usual way to check and time move
+// generation: any change to the rules or to GetActionsForBoard() shows in the counts. A game
+// that ends before depth counts as a single leaf. The state is walked with execute and undo,
+// and is given back unchanged.
+uint64_t Perft(HiveState* state, int depth);
+
+struct PerftEntry {
+  HiveAction action;
+  uint64_t nodes = 0;
+};
+
+// Perft() of each root action, in the order of GetActionsForBoard(). Root actions are shared
+// out to num_threads threads, each walking its own copy of the state.
+std::vector<PerftEntry> PerftDivide(const HiveState& state, int depth, int num_threads = 1);
+
+}  // namespace hive
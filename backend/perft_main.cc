@@ -0,0 +1,42 @@
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+
+#include "backend/perft.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+
+DEFINE_int32(depth, 3, "Plies to count leaf positions at.");
+DEFINE_bool(mosquito, false, "Play with the mosquito.");
+DEFINE_bool(ladybug, false, "Play with the ladybug.");
+DEFINE_bool(pillbug, false, "Play with the pillbug.");
+DEFINE_int32(threads, 1, "Threads sharing out the root actions.");
+DEFINE_bool(divide, false, "Print the leaf count below each root action.");
+
+int main(int argc, char* argv[]) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+
+  hive::InitOption option;
+  option.mosquito = FLAGS_mosquito;
+  option.ladybug = FLAGS_ladybug;
+  option.pillbug = FLAGS_pillbug;
+  hive::HiveState state;
+  state.Initialize(option);
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<hive::PerftEntry> entries = hive::PerftDivide(state, FLAGS_depth, FLAGS_threads);
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+  uint64_t nodes = 0;
+  for (const auto& entry : entries) {
+    if (FLAGS_divide) {
+      std::cout << entry.action << ": " << entry.nodes << std::endl;
+    }
+    nodes += entry.nodes;
+  }
+  std::cout << "depth " << FLAGS_depth << ": " << nodes << " nodes in " << elapsed.count()
+            << " s, " << static_cast<uint64_t>(nodes / elapsed.count()) << " nodes/s"
+            << std::endl;
+  return 0;
+}
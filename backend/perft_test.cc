@@ -0,0 +1,83 @@
+#include "backend/perft.h"
+
+#include <cstdint>
+
+#include "glog/logging.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using namespace hive;
+
+namespace {
+
+HiveState InitialState(bool expansions) {
+  HiveState state;
+  InitOption option;
+  option.mosquito = expansions;
+  option.ladybug = expansions;
+  option.pillbug = expansions;
+  state.Initialize(option);
+  return state;
+}
+
+uint64_t Total(const std::vector<PerftEntry>& entries) {
+  uint64_t nodes = 0;
+  for (const auto& entry : entries) {
+    nodes += entry.nodes;
+  }
+  return nodes;
+}
+
+}  // namespace
+
+// Reference counts, any change to move generation that alters them is a change of the rules.
+TEST(PerftTest, Initial) {
+  HiveState state = InitialState(/*expansions=*/false);
+  EXPECT_EQ(Perft(&state, 1), 5);
+  EXPECT_EQ(Perft(&state, 2), 150);
+  // White may move a queen placed first: 2160 placements and 60 queen slides, 2 for each of
+  // the 30 replies of Black.
+  EXPECT_EQ(Perft(&state, 3), 2220);
+  EXPECT_EQ(Perft(&state, 4), 32856);
+}
+
+TEST(PerftTest, InitialWithExpansions) {
+  HiveState state = InitialState(/*expansions=*/true);
+  EXPECT_EQ(Perft(&state, 1), 8);
+  EXPECT_EQ(Perft(&state, 2), 384);
+  EXPECT_EQ(Perft(&state, 3), 8736);
+  EXPECT_EQ(Perft(&state, 4), 198744);
+}
+
+TEST(PerftTest, MidGame) {
+  HiveState state = InitialState(/*expansions=*/true);
+  for (int ply = 0; ply < 30; ++ply) {
+    ActionList actions;
+    GetActionsForBoard(state, &actions);
+    actions[(ply * 7) % actions.size()].execute(&state);
+  }
+  const uint64_t hash = state.Hash();
+  EXPECT_EQ(Perft(&state, 1), 8);
+  EXPECT_EQ(Perft(&state, 2), 1063);
+  EXPECT_EQ(Perft(&state, 3), 43197);
+  EXPECT_EQ(state.Hash(), hash);
+}
+
+TEST(PerftTest, Divide) {
+  HiveState state = InitialState(/*expansions=*/true);
+  ActionList actions;
+  GetActionsForBoard(state, &actions);
+  std::vector<PerftEntry> entries = PerftDivide(state, 3);
+  ASSERT_EQ(entries.size(), actions.size());
+  for (size_t i = 0; i < entries.size(); ++i) {
+    EXPECT_EQ(entries[i].action, actions[i]);
+  }
+  EXPECT_EQ(Total(entries), 8736);
+
+  std::vector<PerftEntry> threaded = PerftDivide(state, 3, /*num_threads=*/4);
+  ASSERT_EQ(threaded.size(), entries.size());
+  for (size_t i = 0; i < entries.size(); ++i) {
+    EXPECT_EQ(threaded[i].action, entries[i].action);
+    EXPECT_EQ(threaded[i].nodes, entries[i].nodes);
+  }
+}
@@ -0,0 +1,185 @@
+#include "backend/perimeter_graph.h"
+
+#include <algorithm>
+
+#include "backend/neighbour_table.h"
+#include "glog/logging.h"
+
+namespace hive {
+
+void PerimeterGraph::Update(const HiveState& state, const Pos& mover) {
+  CHECK_EQ(mover.z(), 0);
+  // The hash tells boards apart but may collide, the ground cells must match as well.
+  uint64_t hash = state.Hash();
+  if (!built_ || hash != hash_ || state.GetOccupied() != occupied_) {
+    Build(state);
+    built_ = true;
+    hash_ = hash;
+    occupied_ = state.GetOccupied();
+    lifted_ = -1;
+  }
+  int cell = CellIndex(mover);
+  if (lifted_ == cell) {
+    return;
+  }
+  if (lifted_ >= 0) {
+    Restore();
+  }
+  Lift(cell);
+}
+
+void PerimeterGraph::Build(const HiveState& state) {
+  heights_.fill(0);
+  slides_.fill(0);
+  Bitboard occupied;
+  state.ForEachPiece([&](const Pos& pos, const Piece&) {
+    if (pos.z() == 0) {
+      heights_[CellIndex(pos)] = state.GetHeight(pos);
+      occupied.Set(CellIndex(pos));
+    }
+  });
+  occupied.ForEach([&](int cell) {
+    for (int direction = 0; direction < 6; ++direction) {
+      int neighbour = AdjacentCell(cell, direction);
+      if (heights_[neighbour] == 0) {
+        slides_[neighbour] = ComputeSlides(neighbour);
+      }
+    }
+  });
+}
+
+void PerimeterGraph::Lift(int cell) {
+  saved_height_ = heights_[cell];
+  heights_[cell] = 0;
+  saved_slides_[6] = slides_[cell];
+  slides_[cell] = ComputeSlides(cell);
+  for (int direction = 0; direction < 6; ++direction) {
+    int neighbour = AdjacentCell(cell, direction);
+    saved_slides_[direction] = slides_[neighbour];
+    slides_[neighbour] = ComputeSlides(neighbour);
+  }
+  lifted_ = cell;
+}
+
+void PerimeterGraph::Restore() {
+  for (int direction = 0; direction < 6; ++direction) {
+    slides_[AdjacentCell(lifted_, direction)] = saved_slides_[direction];
+  }
+  slides_[lifted_] = saved_slides_[6];
+  heights_[lifted_] = saved_height_;
+  lifted_ = -1;
+}
+
+uint8_t PerimeterGraph::GetMask(int cell, int z) const {
+  uint8_t mask = 0;
+  for (int direction = 0; direction < 6; ++direction) {
+    if (heights_[AdjacentCell(cell, direction)] > z) {
+      mask |= 1 << direction;
+    }
+  }
+  return mask;
+}
+
+uint8_t PerimeterGraph::ComputeSlides(int cell) const {
+  return heights_[cell] > 0 ? 0 : GroundSlides(GetMask(cell, 0));
+}
+
+void PerimeterGraph::GetSlideDestinations(const Pos& from, int distance,
+                                          PosList* destinations) const {
+  CHECK_GE(distance, 1);
+  CHECK_LE(distance, 3);
+  Bitboard found;
+  // Depth-first over paths, path[i] being the cell after i steps and next[i] the next direction
+  // to try out of it.
+  int path[4] = {CellIndex(from)};
+  int next[4] = {0};
+  int depth = 0;
+  while (depth >= 0) {
+    if (depth == distance) {
+      if (!found.Test(path[depth])) {
+        found.Set(path[depth]);
+        destinations->push_back(CellPos(path[depth]));
+      }
+      --depth;
+      continue;
+    }
+    int direction = next[depth]++;
+    if (direction == 6) {
+      --depth;
+      continue;
+    }
+    if (!((slides_[path[depth]] >> direction) & 1)) {
+      continue;
+    }
+    int to = AdjacentCell(path[depth], direction);
+    bool visited = false;
+    for (int i = 0; i < depth; ++i) {
+      visited |= path[i] == to;
+    }
+    if (visited) {
+      continue;
+    }
+    path[depth + 1] = to;
+    next[depth + 1] = 0;
+    ++depth;
+  }
+}
+
+void PerimeterGraph::GetReachable(const Pos& from, PosList* destinations) const {
+  // The lifted cell plus the perimeter.
+  int queue[kMaxPerimeter + 1];
+  queue[0] = CellIndex(from);
+  int size = 1;
+  Bitboard visited;
+  visited.Set(queue[0]);
+  for (int i = 0; i < size; ++i) {
+    uint8_t slides = slides_[queue[i]];
+    for (int direction = 0; direction < 6; ++direction) {
+      int to = AdjacentCell(queue[i], direction);
+      if (!((slides >> direction) & 1) || visited.Test(to)) {
+        continue;
+      }
+      CHECK_LE(size, kMaxPerimeter);
+      visited.Set(to);
+      queue[size++] = to;
+    }
+  }
+  for (int i = 1; i < size; ++i) {
+    destinations->push_back(CellPos(queue[i]));
+  }
+}
+
+void PerimeterGraph::GetLadybugDestinations(const Pos& from, PosList* destinations) const {
+  const int start = CellIndex(from);
+  Bitboard found;
+  // A step is allowed when the cells beside the way are not both taken at the higher of the two
+  // layers it goes between (see IsPieceMoveValid()).
+  auto can_step = [&](int cell, int direction, int z) {
+    return (kNeighbourTable.elevated_gates[GetMask(cell, z)] >> direction) & 1;
+  };
+  for (int first = 0; first < 6; ++first) {
+    int up = AdjacentCell(start, first);
+    int up_z = heights_[up];
+    if (up_z == 0 || !can_step(start, first, up_z)) {
+      continue;
+    }
+    for (int second = 0; second < 6; ++second) {
+      int over = AdjacentCell(up, second);
+      int over_z = heights_[over];
+      if (over_z == 0 || !can_step(up, second, std::max(up_z, over_z))) {
+        continue;
+      }
+      for (int third = 0; third < 6; ++third) {
+        int down = AdjacentCell(over, third);
+        if (heights_[down] != 0 || down == start || found.Test(down) ||
+            !can_step(over, third, over_z)) {
+          continue;
+        }
+        found.Set(down);
+        destinations->push_back(CellPos(down));
+      }
+    }
+  }
+}
+
+}  // namespace hive
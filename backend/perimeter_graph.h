@@ -0,0 +1,56 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "backend/bitboard.h"
+#include "backend/state.h"
+
+namespace hive {
+
+// Empty ground cells around the hive and the legal one-step slides between them.
+// It is built once per board; answering the moves of one piece only needs that piece lifted
+// off, which patches the seven cells around it.
+class PerimeterGraph {
+ public:
+  // Describe the board of state with the piece at `mover` (on the ground) lifted off.
+  // The board part is only rebuilt when state is not the one seen by the previous call.
+  void Update(const HiveState& state, const Pos& mover);
+
+  // Ground slide directions out of an empty cell.
+  uint8_t GetSlides(int cell) const { return slides_[cell]; }
+
+  // The queries below append each destination once to `destinations`.
+  // Cells where a slide of exactly `distance` steps from `from` ends, without visiting any cell
+  // twice on the way: 1 for queen and pillbug, 3 for spider.
+  void GetSlideDestinations(const Pos& from, int distance, PosList* destinations) const;
+  // Every cell reachable by sliding from `from` (ant).
+  void GetReachable(const Pos& from, PosList* destinations) const;
+  // Cells reachable by two steps on top of the hive and one step down (ladybug).
+  void GetLadybugDestinations(const Pos& from, PosList* destinations) const;
+
+ private:
+  void Build(const HiveState& state);
+  void Lift(int cell);
+  void Restore();
+
+  // Bit d is set when the neighbour of cell in kAdjacentDirections[d] has a piece at layer z.
+  uint8_t GetMask(int cell, int z) const;
+  // Slides out of cell, 0 if the cell is occupied.
+  uint8_t ComputeSlides(int cell) const;
+
+  bool built_ = false;
+  uint64_t hash_ = 0;
+  Bitboard occupied_;
+  int lifted_ = -1;
+
+  // Number of pieces on each cell and slide directions out of each empty cell.
+  std::array<uint8_t, kBoardCells> heights_;
+  std::array<uint8_t, kBoardCells> slides_;
+
+  // What Lift() overwrote: the slides of the lifted cell and of its neighbours, then its height.
+  std::array<uint8_t, 7> saved_slides_;
+  uint8_t saved_height_ = 0;
+};
+
+}  // namespace hive
@@ -0,0 +1,66 @@
+#include "backend/perimeter_graph.h"
+
+#include "glog/logging.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using namespace hive;
+
+namespace {
+
+PosList SlideDestinations(const PerimeterGraph& graph, const Pos& from, int distance) {
+  PosList destinations;
+  graph.GetSlideDestinations(from, distance, &destinations);
+  return destinations;
+}
+
+PosList Reachable(const PerimeterGraph& graph, const Pos& from) {
+  PosList destinations;
+  graph.GetReachable(from, &destinations);
+  return destinations;
+}
+
+PosList LadybugDestinations(const PerimeterGraph& graph, const Pos& from) {
+  PosList destinations;
+  graph.GetLadybugDestinations(from, &destinations);
+  return destinations;
+}
+
+}  // namespace
+
+TEST(PerimeterGraphTest, Slides) {
+  // Three pieces in a row, the first one lifted off: the other two are surrounded by a ring of
+  // eight cells, one of them being the lifted cell.
+  HiveState state;
+  state.PutPiece(Pos(0, 0), Piece(PieceType::kAnt, Side::kBlack));
+  state.PutPiece(Pos(1, 0), Piece(PieceType::kQueen, Side::kBlack));
+  state.PutPiece(Pos(2, 0), Piece(PieceType::kQueen, Side::kWhite));
+  PerimeterGraph graph;
+  graph.Update(state, Pos(0, 0));
+  EXPECT_EQ(Reachable(graph, Pos(0, 0)).size(), 7);
+  EXPECT_THAT(SlideDestinations(graph, Pos(0, 0), 1),
+              testing::UnorderedElementsAre(Pos(0, 1), Pos(1, -1)));
+  EXPECT_THAT(SlideDestinations(graph, Pos(0, 0), 3),
+              testing::UnorderedElementsAre(Pos(3, -1), Pos(2, 1)));
+
+  // Lifting another piece puts the first one back.
+  graph.Update(state, Pos(2, 0));
+  EXPECT_EQ(graph.GetSlides(CellIndex(Pos(0, 0))), 0);
+  EXPECT_THAT(SlideDestinations(graph, Pos(2, 0), 1),
+              testing::UnorderedElementsAre(Pos(1, 1), Pos(2, -1)));
+  graph.Update(state, Pos(0, 0));
+  EXPECT_EQ(Reachable(graph, Pos(0, 0)).size(), 7);
+}
+
+TEST(PerimeterGraphTest, Ladybug) {
+  HiveState state;
+  state.PutPiece(Pos(0, 0), Piece(PieceType::kLadybug, Side::kBlack));
+  state.PutPiece(Pos(1, 0), Piece(PieceType::kQueen, Side::kBlack));
+  state.PutPiece(Pos(2, 0), Piece(PieceType::kQueen, Side::kWhite));
+  PerimeterGraph graph;
+  graph.Update(state, Pos(0, 0));
+  // Up on (1, 0), over to (2, 0) and down to any of its free neighbours.
+  EXPECT_THAT(LadybugDestinations(graph, Pos(0, 0)),
+              testing::UnorderedElementsAre(Pos(3, 0), Pos(3, -1), Pos(2, 1), Pos(2, -1),
+                                            Pos(1, 1)));
+}
@@ -1,79 +1,56 @@
 #include "backend/place.h"
 
-#include <unordered_set>
-
 #include "glog/logging.h"
 
 namespace hive {
 
-std::vector<Place> GetPlaceActions(const HiveState& state) {
-  std::vector<Place> actions;
-  std::vector<PieceType> piece_types = GetPlacePieceTypes(state);
-  if (piece_types.size() > 0) {
-    std::vector<Pos> place_positions = GetPlacePositions(state);
-    for (const auto& piece_type : piece_types) {
-      for (const auto& pos : place_positions) {
-        actions.push_back(Place(pos, piece_type));
-      }
-    }
+void GetPlaceActions(const HiveState& state, PlaceList* places) {
+  PlaceOptions options;
+  GetPlaceOptions(state, &options);
+  for (int i = 0; i < options.size(); ++i) {
+    places->push_back(options.at(i));
+  }
+}
+
+void GetPlaceOptions(const HiveState& state, PlaceOptions* options) {
+  GetPlacePieceTypes(state, &options->types);
+  if (options->types.size() > 0) {
+    GetPlacePositions(state, &options->positions);
   }
-  return actions;
 }
 
-std::vector<PieceType> GetPlacePieceTypes(const HiveState& state) {
-  std::vector<PieceType> result;
+void GetPlacePieceTypes(const HiveState& state, PieceTypeList* types) {
   CHECK(state.active_player != Side::kUndefined);
-  if (state.active_player == Side::kBlack) {
-    std::vector<PieceType> available_piece_types;
-    if (state.EnforceQueenPlacement()) {
-      CHECK(state.black_piece_count.at(PieceType::kQueen) == 1);
-      return {PieceType::kQueen};
-    } else {
-      for (const auto& pair : state.black_piece_count) {
-        if (pair.second > 0) {
-          result.push_back(pair.first);
-        }
-      }
-      return result;
-    }
-  } else {
-    std::vector<PieceType> available_piece_types;
-    if (state.EnforceQueenPlacement()) {
-      CHECK(state.white_piece_count.at(PieceType::kQueen) == 1);
-      return {PieceType::kQueen};
-    } else {
-      for (const auto& pair : state.white_piece_count) {
-        if (pair.second > 0) {
-          result.push_back(pair.first);
-        }
-      }
-      return result;
+  if (state.EnforceQueenPlacement()) {
+    CHECK(state.GetPieceCount(state.active_player, PieceType::kQueen) == 1);
+    types->push_back(PieceType::kQueen);
+    return;
+  }
+  for (int i = 0; i < kNumPieceTypes; ++i) {
+    PieceType type = static_cast<PieceType>(i + 1);
+    if (state.GetPieceCount(state.active_player, type) > 0) {
+      types->push_back(type);
     }
   }
 }
 
-std::vector<Pos> GetPlacePositions(const HiveState& state) {
+void GetPlacePositions(const HiveState& state, PosList* positions) {
   // Special case for empty board.
-  if (state.pieces.size() == 0) {
-    return {Pos(0, 0)};
+  if (state.NumPieces() == 0) {
+    positions->emplace_back(0, 0);
+    return;
   }
   // Special case for second move.
-  if (state.pieces.size() == 1) {
-    return Pos(0, 0).GetAdjacentPositions();
-  }
-  // General case
-  std::unordered_set<Pos> positions;
-  for (const auto& pair : state.pieces) {
-    if (pair.second.side == state.active_player) {
-      for (const auto& pos : pair.first.GetAdjacentPositions()) {
-        if (positions.find(pos) == positions.end() && state.IsEmpty(pos) &&
-            !state.HasOpponentNeighbour(pos, state.active_player)) {
-          positions.insert(pos);
-        }
-      }
+  if (state.NumPieces() == 1) {
+    for (const Pos& pos : Pos(0, 0).GetAdjacentPositions()) {
+      positions->push_back(pos);
     }
+    return;
   }
-  return std::vector<Pos>(positions.begin(), positions.end());
+  // General case
+  state.GetPlaceable(state.active_player).ForEach([&](int cell) {
+    positions->push_back(CellPos(cell));
+  });
 }
 
-}  // namespace hive
\ No newline at end of file
+}  // namespace hive
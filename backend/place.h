@@ -1,3 +1,6 @@
+#pragma once
+
+#include "backend/fixed_vector.h"
 #include "backend/state.h"
 
 namespace hive {
@@ -15,11 +18,32 @@ struct Place {
   }
 };
 
+using PlaceList = FixedVector<Place, kNumPieceTypes * kMaxPerimeter>;
+using PieceTypeList = FixedVector<PieceType, kNumPieceTypes>;
+
+// Every place of the active player: each piece type at each position, indexed without
+// materialising the cross product.
+struct PlaceOptions {
+  PieceTypeList types;
+  PosList positions;
+
+  int size() const { return types.size() * positions.size(); }
+  // Piece types vary slowest, in the order GetPlaceActions() lists them.
+  Place at(int i) const {
+    return Place(positions[i % positions.size()], types[i / positions.size()]);
+  }
+};
+
+// The functions below append to their output, without any heap allocation.
+
 // Get available places from current state
-std::vector<Place> GetPlaceActions(const HiveState& state);
+void GetPlaceActions(const HiveState& state, PlaceList* places);
+// Same places as GetPlaceActions(), as types and positions.
+void GetPlaceOptions(const HiveState& state, PlaceOptions* options);
 
-std::vector<PieceType> GetPlacePieceTypes(const HiveState& state);
+void GetPlacePieceTypes(const HiveState& state, PieceTypeList* types);
 // Get the empty position that can be placed for the active player.
-std::vector<Pos> GetPlacePositions(const HiveState& state);
+// O(frontier): a read of HiveState::GetPlaceable() once both sides have placed.
+void GetPlacePositions(const HiveState& state, PosList* positions);
 
 }  // namespace hive
\ No newline at end of file
@@ -7,32 +7,50 @@
 
 using namespace hive;
 
+namespace {
+
+PieceTypeList PlacePieceTypes(const HiveState& state) {
+  PieceTypeList types;
+  GetPlacePieceTypes(state, &types);
+  return types;
+}
+
+PosList PlacePositions(const HiveState& state) {
+  PosList positions;
+  GetPlacePositions(state, &positions);
+  return positions;
+}
+
+}  // namespace
+
 // Test samples are constructed according to official ruling book examples.
 TEST(PlaceTest, GetPlacePieceTypes) {
   HiveState state;
   state.active_player = Side::kBlack;
-  state.black_piece_count = {{PieceType::kAnt, 1}, {PieceType::kBeetle, 0}, {PieceType::kQueen, 1}};
-  EXPECT_THAT(GetPlacePieceTypes(state),
+  state.SetPieceCount(Side::kBlack, PieceType::kAnt, 1);
+  state.SetPieceCount(Side::kBlack, PieceType::kBeetle, 0);
+  state.SetPieceCount(Side::kBlack, PieceType::kQueen, 1);
+  EXPECT_THAT(PlacePieceTypes(state),
               testing::UnorderedElementsAre(PieceType::kAnt, PieceType::kQueen));
   state.black_queen_turn_countdown = 0;
-  EXPECT_THAT(GetPlacePieceTypes(state), testing::UnorderedElementsAre(PieceType::kQueen));
+  EXPECT_THAT(PlacePieceTypes(state), testing::UnorderedElementsAre(PieceType::kQueen));
 }
 
 TEST(PlaceTest, GetPlacePositions) {
   // Initial state must start from (0, 0)
   HiveState state;
   state.active_player = Side::kBlack;
-  EXPECT_THAT(GetPlacePositions(state), testing::UnorderedElementsAre(Pos(0, 0)));
+  EXPECT_THAT(PlacePositions(state), testing::UnorderedElementsAre(Pos(0, 0)));
 
   // The second move must be neighbour.
-  state.pieces[Pos(0, 0)] = Piece(PieceType::kAnt, Side::kBlack);
+  state.PutPiece(Pos(0, 0), Piece(PieceType::kAnt, Side::kBlack));
   state.active_player = Side::kWhite;
-  EXPECT_THAT(GetPlacePositions(state),
+  EXPECT_THAT(PlacePositions(state),
               testing::UnorderedElementsAre(Pos(0, 1), Pos(1, 0), Pos(-1, 1), Pos(-1, 0),
                                             Pos(0, -1), Pos(1, -1)));
   // Case from ruling
-  state.pieces[Pos(0, 1)] = Piece(PieceType::kAnt, Side::kWhite);
+  state.PutPiece(Pos(0, 1), Piece(PieceType::kAnt, Side::kWhite));
   state.active_player = Side::kBlack;
-  EXPECT_THAT(GetPlacePositions(state),
+  EXPECT_THAT(PlacePositions(state),
               testing::UnorderedElementsAre(Pos(-1, 0), Pos(0, -1), Pos(1, -1)));
 }
\ No newline at end of file
@@ -0,0 +1,77 @@
+
+#include "backend/action.h"
+#include "backend/benchmark_util.h"
+#include "backend/state.h"
+#include "backend/strategy.h"
+#include "benchmark/benchmark.h"
+
+namespace hive {
+namespace {
+
+// Random playouts of range(0) plies from the initial position, as MCTS::simulate() runs them.
+void BM_Playout(benchmark::State& bench_state) {
+  const HiveState initial = PlayOpening(0);
+  const int num_plies = bench_state.range(0);
+  Random random(0);
+  for (auto _ : bench_state) {
+    HiveState state(initial);
+    HiveAction action;
+    for (int ply = 0; ply < num_plies; ++ply) {
+      HivePlayoutStrategy playout(&state);
+      playout.setRandom(&random);
+      playout.generateRandom(&action);
+      action.execute(&state);
+    }
+    benchmark::DoNotOptimize(&state);
+  }
+  bench_state.SetItemsProcessed(bench_state.iterations());
+  bench_state.counters["plies"] = benchmark::Counter(
+      bench_state.iterations() * num_plies, benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_Playout)->Arg(50)->Arg(200);
+
+// Random playouts from the initial position until HiveTerminationCheck ends them.
+void BM_PlayoutToEnd(benchmark::State& bench_state) {
+  const HiveState initial = PlayOpening(0);
+  HiveTerminationCheck termination;
+  Random random(0);
+  int64_t num_plies = 0;
+  for (auto _ : bench_state) {
+    HiveState state(initial);
+    HiveAction action;
+    while (!termination.isTerminal(&state)) {
+      HivePlayoutStrategy playout(&state);
+      playout.setRandom(&random);
+      playout.generateRandom(&action);
+      action.execute(&state);
+    }
+    num_plies += state.ply;
+  }
+  bench_state.SetItemsProcessed(bench_state.iterations());
+  bench_state.counters["plies"] = benchmark::Counter(num_plies, benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_PlayoutToEnd);
+
+// The same playouts picking among all the actions of GetActionsForBoard(), as a baseline.
+void BM_PlayoutAllActions(benchmark::State& bench_state) {
+  const HiveState initial = PlayOpening(0);
+  const int num_plies = bench_state.range(0);
+  Random random(0);
+  ActionList actions;
+  for (auto _ : bench_state) {
+    HiveState state(initial);
+    for (int ply = 0; ply < num_plies; ++ply) {
+      actions.clear();
+      GetActionsForBoard(state, &actions);
+      actions[random.below(actions.size())].execute(&state);
+    }
+    benchmark::DoNotOptimize(&state);
+  }
+  bench_state.SetItemsProcessed(bench_state.iterations());
+  bench_state.counters["plies"] = benchmark::Counter(
+      bench_state.iterations() * num_plies, benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_PlayoutAllActions)->Arg(50)->Arg(200);
+
+}  // namespace
+}  // namespace hive
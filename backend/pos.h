@@ -1,12 +1,35 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
 #include <iostream>
-#include <vector>
+#include <string>
+#include <utility>
+
 namespace hive {
 
 // Adjacent directions, ordered in a circle.
-const std::vector<std::pair<int, int>> kAdjacentDirections = {{1, 0},  {1, -1}, {0, -1},
-                                                              {-1, 0}, {-1, 1}, {0, 1}};
+constexpr std::array<std::pair<int, int>, 6> kAdjacentDirections = {
+    {{1, 0}, {1, -1}, {0, -1}, {-1, 0}, {-1, 1}, {0, 1}}};
+
+// The board is a fixed grid of kBoardSize x kBoardSize hex cells whose edges wrap around.
+// A connected hive of at most 28 pieces never spans more than 30 cells along an axis, so two
+// distinct positions of a live game never share a cell.
+constexpr int kBoardBits = 5;
+constexpr int kBoardSize = 1 << kBoardBits;
+constexpr int kBoardMask = kBoardSize - 1;
+constexpr int kBoardCells = kBoardSize * kBoardSize;
+
+// Index of the cell holding (x, y), wrapping around the board edges.
+constexpr int CellIndex(int x, int y) {
+  return ((y & kBoardMask) << kBoardBits) | (x & kBoardMask);
+}
+
+// Index of the cell next to `cell` in kAdjacentDirections[direction].
+constexpr int AdjacentCell(int cell, int direction) {
+  return CellIndex((cell & kBoardMask) + kAdjacentDirections[direction].first,
+                   (cell >> kBoardBits) + kAdjacentDirections[direction].second);
+}
 
 // Position of a piece on the board.
 /* Graph demonstration: (x, y)
@@ -17,33 +40,71 @@ const std::vector<std::pair<int, int>> kAdjacentDirections = {{1, 0},  {1, -1},
  *        (0, -1) (1, -1)
  *       y-
  */
-struct Pos {
-  int x = 0;
-  int y = 0;
-  int z = 0;  // layer, only for beetle
+// It is packed in 16 bits as its layer and cell index, so positions are compared, hashed and
+// stepped as a single integer. Coordinates wrap around the board: x and y read back in
+// [-kBoardSize / 2, kBoardSize / 2).
+class Pos {
+ public:
+  constexpr Pos(int x, int y, int z = 0)
+      : key_(static_cast<uint16_t>(z << (2 * kBoardBits) | CellIndex(x, y))) {}
+
+  // The position of a key() value.
+  static constexpr Pos FromKey(uint16_t key) {
+    Pos pos(0, 0);
+    pos.key_ = key;
+    return pos;
+  }
+
+  constexpr int x() const { return ((key_ + kBoardSize / 2) & kBoardMask) - kBoardSize / 2; }
+  constexpr int y() const {
+    return (((key_ >> kBoardBits) + kBoardSize / 2) & kBoardMask) - kBoardSize / 2;
+  }
+  constexpr int z() const { return key_ >> (2 * kBoardBits); }  // layer, only for beetle
+  constexpr int cell() const { return key_ & (kBoardCells - 1); }
+  constexpr uint16_t key() const { return key_; }
 
-  Pos(int xx, int yy, int zz = 0);
+  // The same cell at layer z.
+  constexpr Pos AtLayer(int z) const {
+    return FromKey(static_cast<uint16_t>(z << (2 * kBoardBits) | cell()));
+  }
+  // The ground position next to this one in kAdjacentDirections[direction].
+  constexpr Pos Adjacent(int direction) const {
+    return FromKey(static_cast<uint16_t>(AdjacentCell(cell(), direction)));
+  }
 
   std::string DebugString() const;
-  friend std::ostream& operator<<(std::ostream& strm, Pos& p) {
+  friend std::ostream& operator<<(std::ostream& strm, const Pos& p) {
     strm << p.DebugString();
     return strm;
   }
 
-  bool operator==(const Pos& other) const;
-  bool operator!=(const Pos& other) const { return !operator==(other); }
+  constexpr bool operator==(const Pos& other) const { return key_ == other.key_; }
+  constexpr bool operator!=(const Pos& other) const { return !operator==(other); }
 
   // Return ajacent positions to Given position. z axis would be always 0.
-  std::vector<Pos> GetAdjacentPositions() const;
+  std::array<Pos, 6> GetAdjacentPositions() const {
+    return {Adjacent(0), Adjacent(1), Adjacent(2), Adjacent(3), Adjacent(4), Adjacent(5)};
+  }
+
+ private:
+  uint16_t key_;
 };
 
+// Index of the cell holding pos.
+constexpr int CellIndex(const Pos& pos) { return pos.cell(); }
+
+// Position of a cell at layer z.
+constexpr Pos CellPos(int cell, int z = 0) {
+  return Pos::FromKey(static_cast<uint16_t>(z << (2 * kBoardBits) | cell));
+}
+
 }  // namespace hive
 
 namespace std {
 // To be used a unordered map key.
 template <>
 struct hash<hive::Pos> {
-  size_t operator()(const hive::Pos& pos) const;
+  size_t operator()(const hive::Pos& pos) const { return pos.key(); }
 };
 
-}  // namespace std
\ No newline at end of file
+}  // namespace std
@@ -16,4 +16,25 @@ TEST(PosTest, Functionality) {
   // Can be used as key
   std::unordered_map<Pos, int> test;
   test.emplace(Pos(1, 2, 3), 4);
-}
\ No newline at end of file
+}
+TEST(PosTest, Packing) {
+  Pos a(-3, 7, 2);
+  EXPECT_EQ(a.x(), -3);
+  EXPECT_EQ(a.y(), 7);
+  EXPECT_EQ(a.z(), 2);
+  EXPECT_EQ(Pos::FromKey(a.key()), a);
+  EXPECT_EQ(a.AtLayer(0), Pos(-3, 7));
+  EXPECT_EQ(a.DebugString(), "(-3,7,2)");
+
+  // Coordinates wrap around the board edges.
+  EXPECT_EQ(Pos(kBoardSize / 2, 0), Pos(-kBoardSize / 2, 0));
+  EXPECT_EQ(Pos(kBoardSize / 2 - 1, 0).Adjacent(0).x(), -kBoardSize / 2);
+}
+
+TEST(PosTest, Adjacent) {
+  std::array<Pos, 6> adjacent = Pos(1, 2, 1).GetAdjacentPositions();
+  for (int direction = 0; direction < 6; ++direction) {
+    EXPECT_EQ(adjacent[direction], Pos(1 + kAdjacentDirections[direction].first,
+                                       2 + kAdjacentDirections[direction].second));
+  }
+}
@@ -1,9 +1,12 @@
 
 #include "backend/state.h"
 
+#include <algorithm>
+#include <array>
 #include <limits>
-#include <unordered_set>
+#include <vector>
 
+#include "backend/zobrist.h"
 #include "glog/logging.h"
 
 namespace hive {
@@ -29,63 +32,340 @@ void DrawEnclosures(std::vector<std::vector<char>>& buffer) {
   }
 }
 
+int SideIndex(Side side) { return static_cast<int>(side) - 1; }
+int TypeIndex(PieceType type) { return static_cast<int>(type) - 1; }
+
+// Start of the window of kBoardSize coordinates holding every set coordinate, so that a hive
+// lying across the wrapping edge of the board is drawn in one piece.
+int GetWindowStart(const std::array<bool, kBoardSize>& used) {
+  // The window starts right after the longest run of unused coordinates.
+  int best_start = -kBoardSize / 2;
+  int best_gap = 0;
+  for (int start = 0; start < kBoardSize; ++start) {
+    int gap = 0;
+    while (gap < kBoardSize && !used[(start + gap) % kBoardSize]) {
+      ++gap;
+    }
+    if (gap > best_gap && gap < kBoardSize) {
+      best_gap = gap;
+      best_start = start + gap;
+    }
+  }
+  return best_start;
+}
+
+int Unwrap(int value, int window_start) {
+  return window_start + ((value - window_start) & kBoardMask);
+}
+
 }  // namespace
 
 void HiveState::Initialize(const InitOption& option) {
-  pieces.clear();
+  occupied_ = Bitboard();
+  stacked_ = Bitboard();
+  side_ = {};
+  type_ = {};
+  neighbour_counts_ = {};
+  placeable_ = {};
+  queen_ = {};
+  num_stacked_ = 0;
+  piece_count_ = {};
+  board_hash_ = 0;
   black_queen_turn_countdown = 4;
   white_queen_turn_countdown = 4;
-  last_moved_piece = boost::none;
-  immobile_piece = boost::none;
+  last_moved_piece.reset();
+  immobile_piece.reset();
   active_player = Side::kBlack;
-  black_piece_count = {{PieceType::kQueen, 1},
-                       {PieceType::kSpider, 2},
-                       {PieceType::kBeetle, 2},
-                       {PieceType::kGrasshopper, 3},
-                       {PieceType::kAnt, 3}};
-  if (option.ladybug) {
-    black_piece_count[PieceType::kLadybug] = 1;
-  }
-  if (option.mosquito) {
-    black_piece_count[PieceType::kMosquito] = 1;
+  ply = 0;
+  for (Side side : {Side::kBlack, Side::kWhite}) {
+    SetPieceCount(side, PieceType::kQueen, 1);
+    SetPieceCount(side, PieceType::kSpider, 2);
+    SetPieceCount(side, PieceType::kBeetle, 2);
+    SetPieceCount(side, PieceType::kGrasshopper, 3);
+    SetPieceCount(side, PieceType::kAnt, 3);
+    SetPieceCount(side, PieceType::kLadybug, option.ladybug ? 1 : 0);
+    SetPieceCount(side, PieceType::kMosquito, option.mosquito ? 1 : 0);
+    SetPieceCount(side, PieceType::kPillbug, option.pillbug ? 1 : 0);
   }
-  if (option.pillbug) {
-    black_piece_count[PieceType::kPillbug] = 1;
-  }
-  white_piece_count = black_piece_count;
 }
 
 void HiveState::print(std::ostream& strm) { strm << DebugString(); }
 
-bool HiveState::IsEmpty(const Pos& pos) const { return pieces.count(pos) == 0; }
-bool HiveState::IsStacked(const Pos& pos) const { return !IsEmpty(Pos(pos.x, pos.y, pos.z + 1)); }
-bool HiveState::IsImmobile(const Pos& pos) const {
-  if (!immobile_piece) {
-    return false;
+bool HiveState::IsEmpty(const Pos& pos) const {
+  int cell = CellIndex(pos);
+  if (pos.z() == 0) {
+    return !occupied_.Test(cell);
   }
-  return (*immobile_piece) == pos;
+  return !stacked_.Test(cell) || FindStacked(cell, pos.z()) < 0;
+}
+bool HiveState::IsStacked(const Pos& pos) const {
+  int cell = CellIndex(pos);
+  if (pos.z() == 0) {
+    return stacked_.Test(cell);
+  }
+  return FindStacked(cell, pos.z() + 1) >= 0;
+}
+bool HiveState::IsImmobile(const Pos& pos) const { return immobile_piece.Holds(pos); }
+bool HiveState::IsLastMoved(const Pos& pos) const { return last_moved_piece.Holds(pos); }
+PieceType HiveState::GetPieceType(const Pos& pos) const { return GetPiece(pos).type; }
+Side HiveState::GetSide(const Pos& pos) const { return GetPiece(pos).side; }
+Piece HiveState::GetPiece(const Pos& pos) const {
+  int cell = CellIndex(pos);
+  if (pos.z() > 0) {
+    int index = FindStacked(cell, pos.z());
+    CHECK_GE(index, 0) << "No piece at " << pos.DebugString();
+    return stack_[index].piece;
+  }
+  CHECK(occupied_.Test(cell)) << "No piece at " << pos.DebugString();
+  Piece piece;
+  piece.side = side_[SideIndex(Side::kBlack)].Test(cell) ? Side::kBlack : Side::kWhite;
+  for (int i = 0; i < kNumPieceTypes; ++i) {
+    if (type_[i].Test(cell)) {
+      piece.type = static_cast<PieceType>(i + 1);
+      break;
+    }
+  }
+  return piece;
 }
-PieceType HiveState::GetPieceType(const Pos& pos) const { return pieces.at(pos).type; }
-Side HiveState::GetSide(const Pos& pos) const { return pieces.at(pos).side; }
 bool HiveState::HasOpponentNeighbour(const Pos& pos, Side side) const {
-  for (const auto& adjacent_position : GetNeighbours(pos)) {
-    if (GetSide(adjacent_position) != side) {
-      return true;
+  return GetNeighbourCount(pos, side == Side::kBlack ? Side::kWhite : Side::kBlack) > 0;
+}
+
+int HiveState::GetNeighbourCount(const Pos& pos, Side side) const {
+  return (neighbour_counts_[CellIndex(pos)] >> (4 * SideIndex(side))) & 0xf;
+}
+
+const Bitboard& HiveState::GetPlaceable(Side side) const { return placeable_[SideIndex(side)]; }
+
+const Bitboard& HiveState::GetOccupied() const { return occupied_; }
+
+void HiveState::UpdateNeighbours(int cell, Side side, int delta) {
+  int shift = 4 * SideIndex(side);
+  for (int direction = 0; direction < 6; ++direction) {
+    int adjacent = AdjacentCell(cell, direction);
+    neighbour_counts_[adjacent] += delta * (1 << shift);
+    UpdatePlaceable(adjacent);
+  }
+  UpdatePlaceable(cell);
+}
+
+void HiveState::UpdatePlaceable(int cell) {
+  int black = neighbour_counts_[cell] & 0xf;
+  int white = neighbour_counts_[cell] >> 4;
+  bool empty = !occupied_.Test(cell);
+  if (empty && black > 0 && white == 0) {
+    placeable_[0].Set(cell);
+  } else {
+    placeable_[0].Reset(cell);
+  }
+  if (empty && white > 0 && black == 0) {
+    placeable_[1].Set(cell);
+  } else {
+    placeable_[1].Reset(cell);
+  }
+}
+
+int HiveState::GetHeight(const Pos& pos) const {
+  int cell = CellIndex(pos);
+  if (!stacked_.Test(cell)) {
+    return occupied_.Test(cell) ? 1 : 0;
+  }
+  int height = 1;
+  for (int i = 0; i < num_stacked_; ++i) {
+    if (stack_[i].cell == cell) {
+      height = std::max(height, stack_[i].z + 1);
     }
   }
-  return false;
+  return height;
 }
 
-std::vector<Pos> HiveState::GetNeighbours(const Pos& pos) const {
-  std::vector<Pos> neighbours;
-  for (const auto& adjacent_position : pos.GetAdjacentPositions()) {
-    if (!IsEmpty(adjacent_position)) {
-      neighbours.push_back(adjacent_position);
+FixedVector<Pos, 6> HiveState::GetNeighbours(const Pos& pos) const {
+  FixedVector<Pos, 6> neighbours;
+  int cell = CellIndex(pos);
+  for (int direction = 0; direction < 6; ++direction) {
+    if (occupied_.Test(AdjacentCell(cell, direction))) {
+      neighbours.push_back(pos.Adjacent(direction));
     }
   }
   return neighbours;
 }
 
+uint8_t HiveState::GetNeighbourMask(const Pos& pos) const {
+  int cell = CellIndex(pos);
+  uint8_t mask = 0;
+  for (int direction = 0; direction < 6; ++direction) {
+    int adjacent = AdjacentCell(cell, direction);
+    bool occupied = pos.z() == 0 ? occupied_.Test(adjacent)
+                               : stacked_.Test(adjacent) && FindStacked(adjacent, pos.z()) >= 0;
+    mask |= occupied << direction;
+  }
+  return mask;
+}
+
+void HiveState::PutPiece(const Pos& pos, const Piece& piece) {
+  CHECK(IsEmpty(pos)) << "Position taken: " << pos.DebugString();
+  int cell = CellIndex(pos);
+  if (pos.z() > 0) {
+    CHECK(!IsEmpty(pos.AtLayer(pos.z() - 1))) << "Nothing below " << pos.DebugString();
+    CHECK_LT(num_stacked_, kMaxStackedPieces);
+    StackedPiece& stacked = stack_[num_stacked_++];
+    stacked.cell = cell;
+    stacked.z = pos.z();
+    stacked.piece = piece;
+    stacked_.Set(cell);
+    board_hash_ ^= zobrist::PieceKey(piece.type, piece.side, cell, pos.z());
+    return;
+  }
+  board_hash_ ^= zobrist::PieceKey(piece.type, piece.side, cell, 0);
+  occupied_.Set(cell);
+  side_[SideIndex(piece.side)].Set(cell);
+  type_[TypeIndex(piece.type)].Set(cell);
+  UpdateNeighbours(cell, piece.side, 1);
+  if (piece.type == PieceType::kQueen) {
+    queen_[SideIndex(piece.side)] = pos;
+  }
+}
+
+Piece HiveState::RemovePiece(const Pos& pos) {
+  CHECK(!IsStacked(pos)) << "Piece covered: " << pos.DebugString();
+  int cell = CellIndex(pos);
+  if (pos.z() > 0) {
+    int index = FindStacked(cell, pos.z());
+    CHECK_GE(index, 0) << "No piece at " << pos.DebugString();
+    Piece piece = stack_[index].piece;
+    stack_[index] = stack_[--num_stacked_];
+    if (pos.z() == 1) {
+      stacked_.Reset(cell);
+    }
+    board_hash_ ^= zobrist::PieceKey(piece.type, piece.side, cell, pos.z());
+    return piece;
+  }
+  Piece piece = GetPiece(pos);
+  board_hash_ ^= zobrist::PieceKey(piece.type, piece.side, cell, 0);
+  occupied_.Reset(cell);
+  side_[SideIndex(piece.side)].Reset(cell);
+  type_[TypeIndex(piece.type)].Reset(cell);
+  UpdateNeighbours(cell, piece.side, -1);
+  if (piece.type == PieceType::kQueen) {
+    queen_[SideIndex(piece.side)].reset();
+  }
+  return piece;
+}
+
+int HiveState::NumPieces() const { return occupied_.Count() + num_stacked_; }
+
+int HiveState::GetQueenNeighbourCount(Side side) const {
+  const OptionalPos& queen = queen_[SideIndex(side)];
+  if (!queen) {
+    return 0;
+  }
+  uint8_t counts = neighbour_counts_[CellIndex(*queen)];
+  return (counts & 0xf) + (counts >> 4);
+}
+
+GameResult HiveState::GetResult() const {
+  bool black_surrounded = GetQueenNeighbourCount(Side::kBlack) == 6;
+  bool white_surrounded = GetQueenNeighbourCount(Side::kWhite) == 6;
+  if (black_surrounded && white_surrounded) {
+    return GameResult::kDraw;
+  }
+  if (black_surrounded) {
+    return GameResult::kWhiteWin;
+  }
+  if (white_surrounded) {
+    return GameResult::kBlackWin;
+  }
+  return GameResult::kOngoing;
+}
+
+Bitboard HiveState::GetArticulationPoints() const {
+  // One board per thread, so that const states are never written and can be shared by the
+  // threads of a search.
+  // The ground pieces they are computed for are the key, as two boards sharing a hash must not
+  // share an answer. Both start empty, which is right for an empty board.
+  thread_local Bitboard articulation_points;
+  thread_local Bitboard articulation_occupied;
+  if (articulation_occupied == occupied_) {
+    return articulation_points;
+  }
+  // Iterative Hopcroft-Tarjan over the ground pieces, run on every component so that
+  // hand-built boards which are not connected still get an answer.
+  constexpr int kMaxGroundPieces = 32;
+  int cells[kMaxGroundPieces];
+  uint8_t index[kBoardCells];  // Only read for occupied cells, which are all written below.
+  int num_nodes = 0;
+  occupied_.ForEach([&](int cell) {
+    CHECK_LT(num_nodes, kMaxGroundPieces);
+    index[cell] = num_nodes;
+    cells[num_nodes++] = cell;
+  });
+
+  int discovery[kMaxGroundPieces];
+  int low[kMaxGroundPieces];
+  int parent[kMaxGroundPieces];
+  int next_direction[kMaxGroundPieces];
+  int stack[kMaxGroundPieces];
+  std::fill(discovery, discovery + num_nodes, -1);
+  articulation_points = Bitboard();
+  int time = 0;
+  for (int root = 0; root < num_nodes; ++root) {
+    if (discovery[root] >= 0) {
+      continue;
+    }
+    int root_children = 0;
+    int stack_size = 0;
+    stack[stack_size++] = root;
+    discovery[root] = low[root] = time++;
+    parent[root] = -1;
+    next_direction[root] = 0;
+    while (stack_size > 0) {
+      int node = stack[stack_size - 1];
+      if (next_direction[node] < 6) {
+        int adjacent = AdjacentCell(cells[node], next_direction[node]++);
+        if (!occupied_.Test(adjacent)) {
+          continue;
+        }
+        int child = index[adjacent];
+        if (discovery[child] < 0) {
+          discovery[child] = low[child] = time++;
+          parent[child] = node;
+          next_direction[child] = 0;
+          stack[stack_size++] = child;
+          if (node == root) {
+            ++root_children;
+          }
+        } else if (child != parent[node]) {
+          low[node] = std::min(low[node], discovery[child]);
+        }
+        continue;
+      }
+      --stack_size;
+      int up = parent[node];
+      if (up < 0) {
+        continue;
+      }
+      low[up] = std::min(low[up], low[node]);
+      if (up != root && low[node] >= discovery[up]) {
+        articulation_points.Set(cells[up]);
+      }
+    }
+    if (root_children > 1) {
+      articulation_points.Set(cells[root]);
+    }
+  }
+  articulation_occupied = occupied_;
+  return articulation_points;
+}
+
+int HiveState::FindStacked(int cell, int z) const {
+  for (int i = 0; i < num_stacked_; ++i) {
+    if (stack_[i].cell == cell && stack_[i].z == z) {
+      return i;
+    }
+  }
+  return -1;
+}
+
 bool HiveState::AllowMovement() const {
   CHECK(active_player != Side::kUndefined);
   if (active_player == Side::kBlack) {
@@ -104,8 +384,56 @@ bool HiveState::EnforceQueenPlacement() const {
   }
 }
 
+int HiveState::GetPieceCount(Side side, PieceType type) const {
+  return piece_count_[SideIndex(side)][TypeIndex(type)];
+}
+
+void HiveState::SetPieceCount(Side side, PieceType type, int count) {
+  int8_t& current = piece_count_[SideIndex(side)][TypeIndex(type)];
+  board_hash_ ^=
+      zobrist::PieceCountKey(side, type, current) ^ zobrist::PieceCountKey(side, type, count);
+  current = count;
+}
+
+uint64_t HiveState::Hash() const { return board_hash_ ^ ScalarHash(); }
+
+uint64_t HiveState::ScalarHash() const {
+  // These fields are public, so they are folded in on read rather than tracked on write.
+  uint64_t hash = zobrist::CountdownKey(Side::kBlack, black_queen_turn_countdown) ^
+                  zobrist::CountdownKey(Side::kWhite, white_queen_turn_countdown);
+  if (active_player == Side::kWhite) {
+    hash ^= zobrist::WhiteToMoveKey();
+  }
+  if (immobile_piece) {
+    hash ^= zobrist::ImmobileKey(CellIndex(*immobile_piece), (*immobile_piece).z());
+  }
+  return hash;
+}
+
+uint64_t HiveState::ComputeHash() const {
+  uint64_t hash = ScalarHash();
+  ForEachPiece([&](const Pos& pos, const Piece& piece) {
+    hash ^= zobrist::PieceKey(piece.type, piece.side, CellIndex(pos), pos.z());
+  });
+  for (Side side : {Side::kBlack, Side::kWhite}) {
+    for (int i = 0; i < kNumPieceTypes; ++i) {
+      PieceType type = static_cast<PieceType>(i + 1);
+      hash ^= zobrist::PieceCountKey(side, type, GetPieceCount(side, type));
+    }
+  }
+  return hash;
+}
+
 std::pair<int, int> HiveState::GetVisualPos(const Pos& pos) const {
-  return std::make_pair(2 * pos.x + pos.y, -pos.y);
+  std::array<bool, kBoardSize> x_used{};
+  std::array<bool, kBoardSize> y_used{};
+  occupied_.ForEach([&](int cell) {
+    x_used[cell & kBoardMask] = true;
+    y_used[cell >> kBoardBits] = true;
+  });
+  int x = Unwrap(pos.x(), GetWindowStart(x_used));
+  int y = Unwrap(pos.y(), GetWindowStart(y_used));
+  return std::make_pair(2 * x + y, -y);
 }
 
 VisualBoardLimit HiveState::GetVisualBoardLimit() const {
@@ -114,13 +442,13 @@ VisualBoardLimit HiveState::GetVisualBoardLimit() const {
   limit.y_max = std::numeric_limits<int>::min();
   limit.x_min = std::numeric_limits<int>::max();
   limit.y_min = std::numeric_limits<int>::max();
-  for (const auto& pair : pieces) {
-    std::pair<int, int> visual_pos = GetVisualPos(pair.first);
+  ForEachPiece([&](const Pos& pos, const Piece&) {
+    std::pair<int, int> visual_pos = GetVisualPos(pos);
     limit.x_max = std::max(visual_pos.first, limit.x_max);
     limit.y_max = std::max(visual_pos.second, limit.y_max);
     limit.x_min = std::min(visual_pos.first, limit.x_min);
     limit.y_min = std::min(visual_pos.second, limit.y_min);
-  }
+  });
   return limit;
 }
 
@@ -131,11 +459,9 @@ std::string HiveState::DebugString() const {
       limit.y_max - limit.y_min + 3, std::vector<char>(limit.x_max - limit.x_min + 3, ' '));
   // Draw enclosure
   DrawEnclosures(output_buffer);
-  for (const auto& pair : pieces) {
-    const Pos& pos = pair.first;
-    const Piece& piece = pair.second;
+  ForEachPiece([&](const Pos& pos, const Piece& piece) {
     if (IsStacked(pos)) {
-      continue;
+      return;
     }
     char piece_name = kPieceTypeName.at(piece.type);
     if (piece.side == Side::kWhite) {
@@ -145,7 +471,7 @@ std::string HiveState::DebugString() const {
     visual_pos.first -= limit.x_min - 1;
     visual_pos.second -= limit.y_min - 1;
     output_buffer.at(visual_pos.second).at(visual_pos.first) = piece_name;
-  }
+  });
 
   std::string debug_string = "board:\n";
   for (const auto& line : output_buffer) {
@@ -160,24 +486,26 @@ std::string HiveState::DebugString() const {
   }
 
   debug_string += "pieces:";
-  for (const auto& pair : black_piece_count) {
-    if (pair.second > 0) {
-      debug_string += kPieceTypeName.at(pair.first) + std::to_string(pair.second);
+  for (int i = 0; i < kNumPieceTypes; ++i) {
+    PieceType type = static_cast<PieceType>(i + 1);
+    if (GetPieceCount(Side::kBlack, type) > 0) {
+      debug_string += kPieceTypeName.at(type) + std::to_string(GetPieceCount(Side::kBlack, type));
     }
   }
   debug_string += " ";
-  for (const auto& pair : white_piece_count) {
-    if (pair.second > 0) {
-      debug_string += static_cast<char>(std::toupper(kPieceTypeName.at(pair.first))) +
-                      std::to_string(pair.second);
+  for (int i = 0; i < kNumPieceTypes; ++i) {
+    PieceType type = static_cast<PieceType>(i + 1);
+    if (GetPieceCount(Side::kWhite, type) > 0) {
+      debug_string += static_cast<char>(std::toupper(kPieceTypeName.at(type))) +
+                      std::to_string(GetPieceCount(Side::kWhite, type));
     }
   }
   debug_string += "\n";
   if (last_moved_piece) {
-    debug_string += "last move:" + last_moved_piece->DebugString() + "\n";
+    debug_string += "last move:" + (*last_moved_piece).DebugString() + "\n";
   }
   if (immobile_piece) {
-    debug_string += "immobile:" + immobile_piece->DebugString() + "\n";
+    debug_string += "immobile:" + (*immobile_piece).DebugString() + "\n";
   }
   if (black_queen_turn_countdown >= 0) {
     debug_string += "q place:" + std::to_string(black_queen_turn_countdown) + "\n";
@@ -1,13 +1,16 @@
 
 #pragma once
 
-#include <boost/optional.hpp>
-#include <optional>
-#include <unordered_map>
-
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <type_traits>
+
+#include "backend/bitboard.h"
 #include "backend/enums.h"
 #include "backend/pos.h"
-#include "third_party/mcts/mcts.hpp"
 
 namespace hive {
 
@@ -18,6 +21,15 @@ struct Piece {
       : type(type_), side(side_) {}
 };
 
+// Number of piece types, kUndefined excluded.
+constexpr int kNumPieceTypes = 8;
+
+// Pieces of both sides with all expansions.
+constexpr int kMaxPieces = 28;
+
+// Pieces that can sit above the ground (beetles and mosquitoes, 3 per side at most).
+constexpr int kMaxStackedPieces = 8;
+
 // This board limit is computed based buffer coordinate.
 struct VisualBoardLimit {
   int x_min;
@@ -32,26 +44,71 @@ struct InitOption {
   bool pillbug = false;
 };
 
-class HiveState : public State {
+// The whole game state is one flat, trivially copyable block: copying it is a memcpy with no
+// heap allocation, which is what MCTS does for every expansion and playout.
+class HiveState {
  public:
   HiveState() = default;
-  ~HiveState() override = default;
 
   void Initialize(const InitOption &option);
 
-  void print(std::ostream &strm) override;
+  void print(std::ostream &strm);
+  friend std::ostream &operator<<(std::ostream &strm, HiveState &s) {
+    s.print(strm);
+    return strm;
+  }
 
   std::string DebugString() const;
 
   bool IsEmpty(const Pos &pos) const;
   bool IsStacked(const Pos &pos) const;
   bool IsImmobile(const Pos &pos) const;
+  bool IsLastMoved(const Pos &pos) const;
   PieceType GetPieceType(const Pos &pos) const;
   Side GetSide(const Pos &pos) const;
+  Piece GetPiece(const Pos &pos) const;
   bool HasOpponentNeighbour(const Pos &pos, Side side) const;
 
+  // Number of ground pieces of a side next to the cell of pos.
+  int GetNeighbourCount(const Pos &pos, Side side) const;
+  // Empty ground cells touching a piece of side and no piece of the other side, i.e. where side
+  // may place once both sides have placed. Maintained on every put and remove.
+  const Bitboard &GetPlaceable(Side side) const;
+  // Ground cells with a piece.
+  const Bitboard &GetOccupied() const;
+
+  // Number of pieces in the column of pos, ignoring pos.z.
+  int GetHeight(const Pos &pos) const;
+
   // Get Non-empty positions that are neighbour to given position.
-  std::vector<Pos> GetNeighbours(const Pos &pos) const;
+  FixedVector<Pos, 6> GetNeighbours(const Pos &pos) const;
+
+  // Bit d is set when the cell next to pos in kAdjacentDirections[d] is occupied at layer pos.z.
+  uint8_t GetNeighbourMask(const Pos &pos) const;
+
+  // Put a piece on an empty position. Pieces above the ground must sit on another piece.
+  void PutPiece(const Pos &pos, const Piece &piece);
+  // Remove the piece at pos, which must not be covered by another piece.
+  Piece RemovePiece(const Pos &pos);
+
+  // Number of pieces on the board.
+  int NumPieces() const;
+
+  // Number of occupied cells around the queen of side, 0 while she is not placed. Pieces stacked
+  // on a neighbour or on the queen do not change it.
+  int GetQueenNeighbourCount(Side side) const;
+  // A side loses when its queen is surrounded, both queens at once is a draw.
+  GameResult GetResult() const;
+
+  // Ground cells whose piece cannot leave without splitting the hive (cut vertices of the
+  // ground level). Computed once per board and cached per thread, returned as a copy so that a
+  // later call on another board leaves it as it is.
+  Bitboard GetArticulationPoints() const;
+
+  // Call f(pos, piece) for every piece on the board, ground pieces first.
+  // Positions are reported with x and y in [-kBoardSize / 2, kBoardSize / 2).
+  template <typename F>
+  void ForEachPiece(F &&f) const;
 
   // If movement is allow (i.e. queen is placed)
   bool AllowMovement() const;
@@ -59,30 +116,104 @@ class HiveState : public State {
   // If this turn a queen must be placed.
   bool EnforceQueenPlacement() const;
 
-  // pieces on the board.
-  std::unordered_map<Pos, Piece> pieces;
+  // Spare pieces of a given type not placed yet.
+  int GetPieceCount(Side side, PieceType type) const;
+  void SetPieceCount(Side side, PieceType type, int count);
+
+  // Zobrist key of the position: every piece with its side and layer, spare pieces, queen
+  // countdowns, the player to move and the piece made immobile by a pillbug.
+  // last_moved_piece is left out, so that transpositions only differing by the last piece moved
+  // share a key; it only restricts which pieces a pillbug may move.
+  uint64_t Hash() const;
+  // Same value as Hash(), recomputed from scratch.
+  uint64_t ComputeHash() const;
 
   // To enforce queen bee placing.
   // Starts from 4, and become 0 indicating queen must be placed.
-  int black_queen_turn_countdown = 4;
-  int white_queen_turn_countdown = 4;
+  int8_t black_queen_turn_countdown = 4;
+  int8_t white_queen_turn_countdown = 4;
 
   // Extra state for pillbug.
   // If set, the piece that just move last turn.
-  boost::optional<Pos> last_moved_piece;
+  OptionalPos last_moved_piece;
   // If set, the piece get moved by pillbug last turn.
-  boost::optional<Pos> immobile_piece;
+  OptionalPos immobile_piece;
 
   // The player that would take action.
   Side active_player = Side::kUndefined;
 
-  // spare pieces not placed.
-  std::unordered_map<PieceType, int> black_piece_count;
-  std::unordered_map<PieceType, int> white_piece_count;
+  // Number of actions executed since Initialize(), left out of Hash().
+  int16_t ply = 0;
 
  protected:
   std::pair<int, int> GetVisualPos(const Pos &pos) const;
   VisualBoardLimit GetVisualBoardLimit() const;
+
+ private:
+  struct StackedPiece {
+    uint16_t cell = 0;
+    uint8_t z = 0;
+    Piece piece;
+  };
+
+  // Key of the countdowns, player to move and immobile piece.
+  uint64_t ScalarHash() const;
+
+  // Index of the stacked piece at (cell, z), -1 if there is none.
+  int FindStacked(int cell, int z) const;
+
+  // Add delta to the neighbour count of side around a ground cell, then refresh placeable_.
+  void UpdateNeighbours(int cell, Side side, int delta);
+  void UpdatePlaceable(int cell);
+
+  // Ground layer, one bitboard per side and per piece type.
+  Bitboard occupied_;
+  Bitboard stacked_;  // Ground cells covered by at least one piece.
+  std::array<Bitboard, 2> side_;
+  std::array<Bitboard, kNumPieceTypes> type_;
+
+  // Ground pieces next to each cell: black in the low 4 bits, white in the high 4 bits.
+  std::array<uint8_t, kBoardCells> neighbour_counts_{};
+  std::array<Bitboard, 2> placeable_;
+
+  // Ground position of each queen, set while she is on the board.
+  std::array<OptionalPos, 2> queen_;
+
+  // Pieces above the ground.
+  std::array<StackedPiece, kMaxStackedPieces> stack_;
+  int8_t num_stacked_ = 0;
+
+  // spare pieces not placed, by side and piece type.
+  std::array<std::array<int8_t, kNumPieceTypes>, 2> piece_count_{};
+
+  // Zobrist key of the pieces and spare pieces, updated on every change.
+  uint64_t board_hash_ = 0;
+};
+
+static_assert(std::is_trivially_copyable<HiveState>::value, "HiveState must stay a flat block");
+
+template <typename F>
+void HiveState::ForEachPiece(F &&f) const {
+  occupied_.ForEach([&](int cell) { f(CellPos(cell), GetPiece(CellPos(cell))); });
+  for (int i = 0; i < num_stacked_; ++i) {
+    f(CellPos(stack_[i].cell, stack_[i].z), stack_[i].piece);
+  }
+}
+
+}  // namespace hive
+
+namespace std {
+
+// Key of a state within a search tree: Hash() mixed with the ply and the last piece moved. Games
+// are cut at a ply count and a pillbug may not move the last piece moved, so states differing in
+// either go on differently. The ply also keeps a state from being reachable from itself.
+template <>
+struct hash<hive::HiveState> {
+  size_t operator()(const hive::HiveState& state) const {
+    const uint64_t last_moved = state.last_moved_piece ? (*state.last_moved_piece).key() : 0xffff;
+    const uint64_t ply = static_cast<uint16_t>(state.ply);
+    return state.Hash() ^ ((ply << 16 | last_moved) + 1) * 0x9e3779b97f4a7c15;
+  }
 };
 
-}  // namespace hive
\ No newline at end of file
+}  // namespace std
@@ -0,0 +1,59 @@
+#include "backend/action.h"
+#include "backend/benchmark_util.h"
+#include "backend/state.h"
+#include "benchmark/benchmark.h"
+
+namespace hive {
+namespace {
+
+// What MCTS pays for every expansion and every playout.
+void BM_CopyState(benchmark::State& bench_state) {
+  const HiveState state = GetCorpusPosition(bench_state.range(0));
+  const int64_t num_allocations = GetNumAllocations();
+  for (auto _ : bench_state) {
+    HiveState copy(state);
+    benchmark::DoNotOptimize(&copy);
+    benchmark::ClobberMemory();
+  }
+  ReportCounters(bench_state, num_allocations, bench_state.iterations());
+  bench_state.counters["bytes"] = sizeof(HiveState);
+}
+BENCHMARK(BM_CopyState)->DenseRange(0, kNumCorpusPositions - 1);
+
+// Every action of the position executed on a copy, as in expansion. Items are actions.
+void BM_Execute(benchmark::State& bench_state) {
+  const HiveState state = GetCorpusPosition(bench_state.range(0));
+  ActionList actions;
+  GetActionsForBoard(state, &actions);
+  const int64_t num_allocations = GetNumAllocations();
+  for (auto _ : bench_state) {
+    for (const HiveAction& action : actions) {
+      HiveState copy(state);
+      action.execute(&copy);
+      benchmark::DoNotOptimize(&copy);
+    }
+  }
+  ReportCounters(bench_state, num_allocations, bench_state.iterations() * actions.size());
+}
+BENCHMARK(BM_Execute)->DenseRange(0, kNumCorpusPositions - 1);
+
+// Every action of the position executed then undone on the same state. Items are actions.
+void BM_ExecuteUndo(benchmark::State& bench_state) {
+  HiveState state = GetCorpusPosition(bench_state.range(0));
+  ActionList actions;
+  GetActionsForBoard(state, &actions);
+  const int64_t num_allocations = GetNumAllocations();
+  for (auto _ : bench_state) {
+    for (const HiveAction& action : actions) {
+      UndoRecord record;
+      action.execute(&state, &record);
+      benchmark::DoNotOptimize(&state);
+      action.undo(&state, record);
+    }
+  }
+  ReportCounters(bench_state, num_allocations, bench_state.iterations() * actions.size());
+}
+BENCHMARK(BM_ExecuteUndo)->DenseRange(0, kNumCorpusPositions - 1);
+
+}  // namespace
+}  // namespace hive
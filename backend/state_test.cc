@@ -0,0 +1,135 @@
+#include "backend/state.h"
+
+#include "glog/logging.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using namespace hive;
+
+TEST(StateTest, PutAndRemove) {
+  HiveState state;
+  state.PutPiece(Pos(0, 0), Piece(PieceType::kAnt, Side::kBlack));
+  state.PutPiece(Pos(1, 0), Piece(PieceType::kQueen, Side::kWhite));
+  state.PutPiece(Pos(1, 0, 1), Piece(PieceType::kBeetle, Side::kBlack));
+  state.PutPiece(Pos(1, 0, 2), Piece(PieceType::kMosquito, Side::kWhite));
+  EXPECT_EQ(state.NumPieces(), 4);
+  EXPECT_FALSE(state.IsEmpty(Pos(0, 0)));
+  EXPECT_TRUE(state.IsEmpty(Pos(0, 0, 1)));
+  EXPECT_TRUE(state.IsEmpty(Pos(-1, 0)));
+  EXPECT_TRUE(state.IsStacked(Pos(1, 0)));
+  EXPECT_TRUE(state.IsStacked(Pos(1, 0, 1)));
+  EXPECT_FALSE(state.IsStacked(Pos(1, 0, 2)));
+  EXPECT_EQ(state.GetHeight(Pos(1, 0)), 3);
+  EXPECT_EQ(state.GetHeight(Pos(0, 0)), 1);
+  EXPECT_EQ(state.GetHeight(Pos(0, 1)), 0);
+  EXPECT_EQ(state.GetPieceType(Pos(1, 0)), PieceType::kQueen);
+  EXPECT_EQ(state.GetSide(Pos(1, 0)), Side::kWhite);
+  EXPECT_EQ(state.GetPieceType(Pos(1, 0, 1)), PieceType::kBeetle);
+  EXPECT_EQ(state.GetSide(Pos(1, 0, 2)), Side::kWhite);
+  EXPECT_THAT(state.GetNeighbours(Pos(1, -1)), testing::UnorderedElementsAre(Pos(0, 0), Pos(1, 0)));
+  EXPECT_TRUE(state.HasOpponentNeighbour(Pos(0, 1), Side::kBlack));
+  EXPECT_FALSE(state.HasOpponentNeighbour(Pos(-1, 0), Side::kBlack));
+
+  EXPECT_EQ(state.RemovePiece(Pos(1, 0, 2)).type, PieceType::kMosquito);
+  EXPECT_EQ(state.RemovePiece(Pos(1, 0, 1)).type, PieceType::kBeetle);
+  EXPECT_FALSE(state.IsStacked(Pos(1, 0)));
+  EXPECT_EQ(state.RemovePiece(Pos(0, 0)).side, Side::kBlack);
+  EXPECT_EQ(state.NumPieces(), 1);
+}
+
+TEST(StateTest, WrapAround) {
+  // A hive lying across the edge of the board.
+  HiveState state;
+  int edge = kBoardSize / 2 - 1;
+  state.PutPiece(Pos(edge, 0), Piece(PieceType::kAnt, Side::kBlack));
+  state.PutPiece(Pos(edge + 1, 0), Piece(PieceType::kAnt, Side::kWhite));
+  EXPECT_FALSE(state.IsEmpty(Pos(-edge - 1, 0)));
+  EXPECT_THAT(state.GetNeighbours(Pos(edge, 0)), testing::ElementsAre(Pos(edge + 1, 0)));
+
+  std::vector<Pos> positions;
+  state.ForEachPiece([&](const Pos& pos, const Piece&) { positions.push_back(pos); });
+  EXPECT_THAT(positions, testing::UnorderedElementsAre(Pos(edge, 0), Pos(-edge - 1, 0)));
+}
+
+TEST(StateTest, ArticulationPoints) {
+  /*  A ring of six around (0, 0) with a tail at (2, 0).
+   *  +-------+
+   *  | a a   |
+   *  |a   a a|
+   *  | a a   |
+   *  +-------+
+   */
+  HiveState state;
+  for (const auto& pos : Pos(0, 0).GetAdjacentPositions()) {
+    state.PutPiece(pos, Piece(PieceType::kAnt, Side::kBlack));
+  }
+  state.PutPiece(Pos(2, 0), Piece(PieceType::kAnt, Side::kWhite));
+  std::vector<Pos> pinned;
+  state.GetArticulationPoints().ForEach([&](int cell) { pinned.push_back(CellPos(cell)); });
+  EXPECT_THAT(pinned, testing::ElementsAre(Pos(1, 0)));
+
+  // Breaking the ring pins the inner pieces of the chain left; the cache follows the board.
+  state.RemovePiece(Pos(-1, 1));
+  pinned.clear();
+  state.GetArticulationPoints().ForEach([&](int cell) { pinned.push_back(CellPos(cell)); });
+  EXPECT_THAT(pinned, testing::UnorderedElementsAre(Pos(1, 0), Pos(1, -1), Pos(0, -1)));
+
+  // The points of one board are kept while another board fills the cache.
+  const Bitboard points = state.GetArticulationPoints();
+  HiveState other = state;
+  other.RemovePiece(Pos(-1, 0));
+  EXPECT_NE(other.GetArticulationPoints(), points);
+  EXPECT_EQ(state.GetArticulationPoints(), points);
+  EXPECT_TRUE(points.Test(CellIndex(Pos(0, -1))));
+}
+
+TEST(StateTest, Placeable) {
+  HiveState state;
+  state.PutPiece(Pos(0, 0), Piece(PieceType::kAnt, Side::kBlack));
+  state.PutPiece(Pos(1, 0), Piece(PieceType::kAnt, Side::kWhite));
+  EXPECT_EQ(state.GetNeighbourCount(Pos(1, -1), Side::kBlack), 1);
+  EXPECT_EQ(state.GetNeighbourCount(Pos(1, -1), Side::kWhite), 1);
+  EXPECT_EQ(state.GetPlaceable(Side::kBlack).Count(), 3);
+  EXPECT_TRUE(state.GetPlaceable(Side::kBlack).Test(CellIndex(Pos(-1, 0))));
+  EXPECT_FALSE(state.GetPlaceable(Side::kBlack).Test(CellIndex(Pos(0, 1))));
+  EXPECT_EQ(state.GetPlaceable(Side::kWhite).Count(), 3);
+
+  // Pieces on top do not change the colour a cell touches.
+  state.PutPiece(Pos(1, 0, 1), Piece(PieceType::kBeetle, Side::kBlack));
+  EXPECT_EQ(state.GetPlaceable(Side::kBlack).Count(), 3);
+
+  state.RemovePiece(Pos(1, 0, 1));
+  state.RemovePiece(Pos(1, 0));
+  EXPECT_EQ(state.GetNeighbourCount(Pos(1, -1), Side::kWhite), 0);
+  EXPECT_EQ(state.GetPlaceable(Side::kBlack).Count(), 6);
+  EXPECT_TRUE(state.GetPlaceable(Side::kWhite).Empty());
+}
+
+TEST(StateTest, QueenSurround) {
+  HiveState state;
+  EXPECT_EQ(state.GetQueenNeighbourCount(Side::kBlack), 0);
+  state.PutPiece(Pos(0, 0), Piece(PieceType::kQueen, Side::kBlack));
+  state.PutPiece(Pos(2, 0), Piece(PieceType::kQueen, Side::kWhite));
+  for (int direction = 0; direction < 5; ++direction) {
+    state.PutPiece(Pos(0, 0).Adjacent(direction), Piece(PieceType::kAnt, Side::kWhite));
+  }
+  EXPECT_EQ(state.GetQueenNeighbourCount(Side::kBlack), 5);
+  EXPECT_EQ(state.GetQueenNeighbourCount(Side::kWhite), 1);
+  EXPECT_EQ(state.GetResult(), GameResult::kOngoing);
+
+  // A beetle on top of the queen or of a neighbour does not surround her.
+  state.PutPiece(Pos(0, 0, 1), Piece(PieceType::kBeetle, Side::kWhite));
+  state.PutPiece(Pos(1, 0, 1), Piece(PieceType::kBeetle, Side::kBlack));
+  EXPECT_EQ(state.GetQueenNeighbourCount(Side::kBlack), 5);
+
+  // Climbing down into the last free cell does.
+  state.PutPiece(Pos(0, 0).Adjacent(5), state.RemovePiece(Pos(1, 0, 1)));
+  EXPECT_EQ(state.GetQueenNeighbourCount(Side::kBlack), 6);
+  EXPECT_EQ(state.GetResult(), GameResult::kWhiteWin);
+
+  // Moving the queen out follows her.
+  state.RemovePiece(Pos(0, 0, 1));
+  state.PutPiece(Pos(-2, 0), state.RemovePiece(Pos(0, 0)));
+  EXPECT_EQ(state.GetQueenNeighbourCount(Side::kBlack), 1);
+  EXPECT_EQ(state.GetResult(), GameResult::kOngoing);
+}
@@ -0,0 +1,138 @@
+#include "backend/strategy.h"
+
+#include "glog/logging.h"
+
+namespace hive {
+
+HiveExpansionStrategy::HiveExpansionStrategy(HiveState* state)
+    : ExpansionStrategy<HiveState, HiveAction>(state) {}
+
+bool HiveExpansionStrategy::canGenerateNext() {
+  if (stage_ == Stage::kStart) {
+    Advance();
+  }
+  return has_next_;
+}
+
+void HiveExpansionStrategy::generateNext(HiveAction* action) {
+  CHECK(canGenerateNext());
+  *action = next_;
+  Advance();
+}
+
+void HiveExpansionStrategy::Advance() {
+  has_next_ = false;
+  while (true) {
+    switch (stage_) {
+      case Stage::kStart:
+        GetPlaceOptions(*state, &places_);
+        stage_ = Stage::kPlace;
+        break;
+      case Stage::kPlace:
+        if (place_index_ < places_.size()) {
+          next_.BuildPlaceAction(places_.at(place_index_++));
+          has_next_ = found_ = true;
+          return;
+        }
+        if (state->AllowMovement()) {
+          GetMovablePieces(*state, &pieces_);
+        }
+        stage_ = Stage::kMove;
+        break;
+      case Stage::kMove: {
+        if (move_index_ < moves_.size()) {
+          next_ = moves_[move_index_++];
+          has_next_ = found_ = true;
+          return;
+        }
+        if (piece_index_ == pieces_.size()) {
+          stage_ = Stage::kPass;
+          break;
+        }
+        // Scratch space shared by the strategies of a thread, moves_ keeps them packed.
+        thread_local MoveList piece_moves;
+        piece_moves.clear();
+        GetMovePositions(*state, pieces_[piece_index_++], &piece_moves);
+        moves_.clear();
+        move_index_ = 0;
+        for (const Move& move : piece_moves) {
+          moves_.emplace_back().BuildMoveAction(move);
+        }
+        break;
+      }
+      case Stage::kPass:
+        stage_ = Stage::kDone;
+        if (!found_) {
+          // Only pass if no available move.
+          next_.BuildPassAction();
+          has_next_ = true;
+          return;
+        }
+        break;
+      case Stage::kDone:
+        return;
+    }
+  }
+}
+
+HivePlayoutStrategy::HivePlayoutStrategy(HiveState* state)
+    : PlayoutStrategy<HiveState, HiveAction>(state) {}
+
+void HivePlayoutStrategy::generateRandom(HiveAction* action) {
+  PieceTypeList types;
+  GetPlacePieceTypes(*state, &types);
+  PieceList pieces;
+  if (state->AllowMovement()) {
+    GetMovablePieces(*state, &pieces);
+  }
+  // Candidates below pieces.size() are pieces, pieces.size() is placing if there is any type.
+  int num_candidates = pieces.size() + (types.empty() ? 0 : 1);
+  while (num_candidates > 0) {
+    int candidate = random->below(num_candidates);
+    if (candidate == pieces.size()) {
+      PosList positions;
+      GetPlacePositions(*state, &positions);
+      if (!positions.empty()) {
+        action->BuildPlaceAction(
+            Place(positions[random->below(positions.size())], types[random->below(types.size())]));
+        return;
+      }
+      --num_candidates;
+      continue;
+    }
+    thread_local MoveList moves;
+    moves.clear();
+    GetMovePositions(*state, pieces[candidate], &moves);
+    if (!moves.empty()) {
+      action->BuildMoveAction(moves[random->below(moves.size())]);
+      return;
+    }
+    // Drop the piece, placing stays the last candidate.
+    pieces[candidate] = pieces[pieces.size() - 1];
+    pieces.Truncate(pieces.size() - 1);
+    --num_candidates;
+  }
+  // Only pass if no available move.
+  action->BuildPassAction();
+}
+
+bool HiveTerminationCheck::isTerminal(HiveState* state) {
+  return state->ply >= max_plies_ || state->GetResult() != GameResult::kOngoing;
+}
+
+float HiveScoring::score(HiveState* state) {
+  switch (state->GetResult()) {
+    case GameResult::kBlackWin:
+      return 1;
+    case GameResult::kWhiteWin:
+      return 0;
+    default:
+      return 0.5;
+  }
+}
+
+float HiveBackpropagation::updateScore(HiveState* state, float backprop_score) {
+  return state->active_player == Side::kWhite ? backprop_score : 1 - backprop_score;
+}
+
+}  // namespace hive
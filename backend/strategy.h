@@ -1,6 +1,101 @@
+#pragma once
+
+#include <cstdint>
+
+#include "backend/action.h"
+#include "backend/fixed_vector.h"
+#include "backend/moves.h"
+#include "backend/place.h"
+#include "backend/state.h"
+#include "third_party/mcts/mcts.hpp"
 
 namespace hive {
 
-class HiveExpansionStrategy : ExpansionStrategy<HiveState, HiveAction> {};
+// Games still going after this many plies are scored as a draw.
+constexpr int kMaxPlies = 400;
+
+// Upper bound of the moves of one piece: a mosquito copying an ant and a pillbug.
+constexpr int kMaxPieceMoves = 256;
+
+// Yields the actions of a state one at a time, in the order of GetActionsForBoard(): placements
+// first, then moves piece by piece. A piece's moves are only generated once those of the
+// previous piece have all been handed out, so a node expanded a few times never pays for the
+// whole move generation. One action is kept ahead, which makes canGenerateNext() a flag read.
+class HiveExpansionStrategy : public ExpansionStrategy<HiveState, HiveAction> {
+ public:
+  explicit HiveExpansionStrategy(HiveState* state);
+
+  void generateNext(HiveAction* action) override;
+  bool canGenerateNext() override;
+
+ private:
+  enum class Stage : uint8_t {
+    kStart,
+    kPlace,
+    kMove,
+    kPass,
+    kDone,
+  };
+
+  // Find the action after next_, setting has_next_.
+  void Advance();
+
+  Stage stage_ = Stage::kStart;
+  bool has_next_ = false;
+  // If any placement or move was found, otherwise the only action is a pass.
+  bool found_ = false;
+  HiveAction next_;
+
+  PlaceOptions places_;
+  int place_index_ = 0;
+
+  PieceList pieces_;
+  int piece_index_ = 0;
+  // Moves of pieces_[piece_index_ - 1] not handed out yet.
+  FixedVector<HiveAction, kMaxPieceMoves> moves_;
+  int move_index_ = 0;
+};
+
+// Picks a random legal action without listing them all: a candidate is drawn among the movable
+// pieces and placing a new piece, then one of its actions. Candidates without any action are
+// dropped and another one is drawn. A ply costs the moves of the pieces drawn, not the whole
+// branching factor. Every candidate is equally likely, not every action. Numbers are drawn from
+// the Random set by setRandom(), the searching thread's one under MCTS.
+class HivePlayoutStrategy : public PlayoutStrategy<HiveState, HiveAction> {
+ public:
+  explicit HivePlayoutStrategy(HiveState* state);
+
+  void generateRandom(HiveAction* action) override;
+};
+
+// A game ends when a queen is surrounded or after max_plies, both read in constant time.
+class HiveTerminationCheck : public TerminationCheck<HiveState> {
+ public:
+  explicit HiveTerminationCheck(int max_plies = kMaxPlies) : max_plies_(max_plies) {}
+
+  bool isTerminal(HiveState* state) override;
+
+ private:
+  int max_plies_;
+};
+
+// Score of an ended game for black: 1 for a win, 0 for a loss, 0.5 for a draw or a game cut at
+// the ply cap.
+class HiveScoring : public Scoring<HiveState> {
+ public:
+  float score(HiveState* state) override;
+};
+
+// A node holds the state after its action, whose mover is the other side than the one to play.
+// Scores are turned to the mover's point of view, so that every node maximizes its own side.
+class HiveBackpropagation : public Backpropagation<HiveState> {
+ public:
+  float updateScore(HiveState* state, float backprop_score) override;
+};
+
+}  // namespace hive
 
-}  // namespace hive
\ No newline at end of file
+// Members are all trivially destructible, a search tree can drop its strategies without
+// running their destructor.
+template <>
+struct ArenaSkipsDestructor<hive::HiveExpansionStrategy> : std::true_type {};
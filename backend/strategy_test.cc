@@ -0,0 +1,372 @@
+#include "backend/strategy.h"
+
+#include <memory>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "glog/logging.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using namespace hive;
+
+TEST(StrategyTest, ExpansionMatchesActionsForBoard) {
+  HiveState state;
+  InitOption option;
+  option.mosquito = true;
+  option.ladybug = true;
+  option.pillbug = true;
+  state.Initialize(option);
+  for (int ply = 0; ply < 120; ++ply) {
+    ActionList actions;
+    GetActionsForBoard(state, &actions);
+
+    HiveExpansionStrategy expansion(&state);
+    std::vector<HiveAction> generated;
+    while (expansion.canGenerateNext()) {
+      expansion.generateNext(&generated.emplace_back());
+    }
+    ASSERT_THAT(generated, testing::ElementsAreArray(actions.begin(), actions.end()))
+        << state.DebugString();
+
+    actions[(ply * 13) % actions.size()].execute(&state);
+  }
+}
+
+TEST(StrategyTest, PlayoutIsLegal) {
+  Random random(7);
+  HiveState state;
+  InitOption option;
+  option.mosquito = true;
+  option.ladybug = true;
+  option.pillbug = true;
+  state.Initialize(option);
+  for (int ply = 0; ply < 200; ++ply) {
+    ActionList actions;
+    GetActionsForBoard(state, &actions);
+    HiveAction action;
+    HivePlayoutStrategy playout(&state);
+    playout.setRandom(&random);
+    playout.generateRandom(&action);
+    ASSERT_THAT(actions, testing::Contains(action)) << action.DebugString();
+    action.execute(&state);
+  }
+}
+
+TEST(StrategyTest, Termination) {
+  HiveState state;
+  InitOption option;
+  state.Initialize(option);
+  HiveTerminationCheck termination(/*max_plies=*/4);
+  HiveScoring scoring;
+  HiveBackpropagation backprop;
+  EXPECT_FALSE(termination.isTerminal(&state));
+
+  // Black queen surrounded after white moved.
+  state.PutPiece(Pos(0, 0), Piece(PieceType::kQueen, Side::kBlack));
+  for (int direction = 0; direction < 6; ++direction) {
+    state.PutPiece(Pos(0, 0).Adjacent(direction), Piece(PieceType::kAnt, Side::kWhite));
+  }
+  state.active_player = Side::kBlack;
+  EXPECT_TRUE(termination.isTerminal(&state));
+  EXPECT_EQ(scoring.score(&state), 0);
+  EXPECT_EQ(backprop.updateScore(&state, scoring.score(&state)), 1);
+
+  state.RemovePiece(Pos(1, 0));
+  EXPECT_FALSE(termination.isTerminal(&state));
+  state.ply = 4;
+  EXPECT_TRUE(termination.isTerminal(&state));
+  EXPECT_EQ(scoring.score(&state), 0.5);
+}
+
+using HiveMCTS = MCTS<HiveState, HiveAction, HiveExpansionStrategy, HivePlayoutStrategy>;
+
+// A search from the initial state with the pillbug, of at least the given iterations, whose
+// playouts stop after max_plies.
+std::unique_ptr<HiveMCTS> NewSearch(int iterations, int max_plies = 30) {
+  HiveState* state = new HiveState();
+  InitOption option;
+  option.pillbug = true;
+  state->Initialize(option);
+  std::unique_ptr<HiveMCTS> mcts(new HiveMCTS(state, new HiveBackpropagation(),
+                                              new HiveTerminationCheck(max_plies),
+                                              new HiveScoring()));
+  mcts->setTime(0);
+  mcts->setMinIterations(iterations);
+  return mcts;
+}
+
+TEST(StrategyTest, Search) {
+  std::unique_ptr<HiveMCTS> mcts = NewSearch(500);
+  ActionList actions;
+  GetActionsForBoard(*mcts->getRoot().getData(), &actions);
+  mcts->setSeed(3);
+  std::unique_ptr<HiveAction> action(mcts->calculateAction());
+  EXPECT_THAT(actions, testing::Contains(*action));
+  EXPECT_EQ(mcts->getIterations(), 500);
+  EXPECT_GT(mcts->getNumNodes(), 1);
+  EXPECT_GE(mcts->getBytesUsed(), mcts->getNumNodes() * sizeof(HiveState));
+  EXPECT_GE(mcts->getBytesReserved(), mcts->getBytesUsed());
+}
+
+// Visits of the children of the root after a search of 300 iterations with the given seed.
+std::vector<std::pair<uint32_t, int>> SearchRootVisits(uint64_t seed) {
+  std::unique_ptr<HiveMCTS> mcts = NewSearch(300);
+  mcts->setSeed(seed);
+  std::unique_ptr<HiveAction> action(mcts->calculateAction());
+  std::vector<std::pair<uint32_t, int>> visits;
+  mcts->forEachRootAction([&](const HiveAction& child_action, int child_visits, float) {
+    visits.emplace_back(child_action.bits(), child_visits);
+  });
+  return visits;
+}
+
+TEST(StrategyTest, SearchIsReproducible) {
+  const std::vector<std::pair<uint32_t, int>> visits = SearchRootVisits(11);
+  EXPECT_EQ(SearchRootVisits(11), visits);
+  EXPECT_NE(SearchRootVisits(12), visits);
+}
+
+// Nodes in the subtree of node, node included.
+template <class N>
+int CountNodes(N* node) {
+  int count = 1;
+  node->getChildren().forEach(
+      [&](const HiveAction&, int, float, N* child) { count += CountNodes(child); });
+  return count;
+}
+
+TEST(StrategyTest, TreeReuse) {
+  std::unique_ptr<HiveMCTS> mcts = NewSearch(500);
+  HiveState game = *mcts->getRoot().getData();
+  std::unique_ptr<HiveAction> action(mcts->calculateAction());
+  auto* child = mcts->getRoot().getChildren().selectBestAverage();
+  ASSERT_EQ(child->getAction(), *action);
+  const int subtree_nodes = CountNodes(child);
+  const int child_visits = child->getNumVisits();
+  const float child_score = child->getAvgScore();
+  const int grandchildren = child->getChildren().size();
+
+  EXPECT_EQ(mcts->advance(*action), subtree_nodes);
+  action->execute(&game);
+  EXPECT_EQ(mcts->getNumNodes(), subtree_nodes);
+  EXPECT_EQ(CountNodes(&mcts->getRoot()), subtree_nodes);
+  EXPECT_EQ(mcts->getRoot().getNumVisits(), child_visits);
+  EXPECT_EQ(mcts->getRoot().getAvgScore(), child_score);
+  EXPECT_EQ(mcts->getRoot().getChildren().size(), grandchildren);
+  EXPECT_EQ(mcts->getRoot().getData()->Hash(), game.Hash());
+
+  // The search goes on from the visits kept.
+  mcts->setMinIterations(200);
+  action.reset(mcts->calculateAction());
+  EXPECT_EQ(mcts->getIterations(), 200);
+  EXPECT_EQ(mcts->getRoot().getNumVisits(), child_visits + 200);
+  ActionList actions;
+  GetActionsForBoard(game, &actions);
+  EXPECT_THAT(actions, testing::Contains(*action));
+
+  // An action never expanded leaves only the new root.
+  HiveAction pass;
+  pass.BuildPassAction();
+  const size_t bytes_used = mcts->getBytesUsed();
+  EXPECT_EQ(mcts->advance(pass), 1);
+  EXPECT_EQ(mcts->getRoot().getNumVisits(), 0);
+  EXPECT_LT(mcts->getBytesUsed(), bytes_used);
+  action.reset(mcts->calculateAction());
+  EXPECT_EQ(mcts->getIterations(), 200);
+}
+
+TEST(StrategyTest, SearchTranspositions) {
+  using HiveNode = Node<HiveState, HiveAction, HiveExpansionStrategy>;
+  std::unique_ptr<HiveMCTS> mcts = NewSearch(3000, /*max_plies=*/12);
+  ActionList actions;
+  GetActionsForBoard(*mcts->getRoot().getData(), &actions);
+  mcts->setTranspositionTableSize(1 << 16);
+  mcts->setSeed(5);
+  std::unique_ptr<HiveAction> action(mcts->calculateAction());
+  EXPECT_THAT(actions, testing::Contains(*action));
+  EXPECT_EQ(mcts->getRoot().getNumVisits(), 3000);
+  // Every lookup but the hits made a node.
+  EXPECT_EQ(mcts->getNumNodes(),
+            1 + mcts->getTranspositionLookups() - mcts->getTranspositionHits());
+
+  // Every state reached has one node, and the nodes reached by several edges are shared.
+  std::unordered_map<size_t, HiveNode*> nodes;
+  std::unordered_map<HiveNode*, int> num_parents;
+  std::vector<HiveNode*> stack = {&mcts->getRoot()};
+  while (!stack.empty()) {
+    HiveNode* node = stack.back();
+    stack.pop_back();
+    auto inserted = nodes.emplace(std::hash<HiveState>()(*node->getData()), node);
+    EXPECT_EQ(inserted.first->second, node);
+    if (!inserted.second) {
+      continue;
+    }
+    node->getChildren().forEach([&](const HiveAction&, int, float, HiveNode* child) {
+      ++num_parents[child];
+      stack.push_back(child);
+    });
+  }
+  EXPECT_EQ(nodes.size(), mcts->getNumNodes());
+  for (const auto& [node, count] : num_parents) {
+    EXPECT_EQ(node->isShared(), count > 1);
+  }
+}
+
+TEST(StrategyTest, SearchThreads) {
+  std::unique_ptr<HiveMCTS> mcts = NewSearch(1000);
+  ActionList actions;
+  GetActionsForBoard(*mcts->getRoot().getData(), &actions);
+  mcts->setThreads(4);
+  std::unique_ptr<HiveAction> action(mcts->calculateAction());
+  EXPECT_THAT(actions, testing::Contains(*action));
+  EXPECT_EQ(mcts->getIterations(), 1000);
+  // Every virtual loss was taken back.
+  EXPECT_EQ(mcts->getRoot().getNumVisits(), 1000);
+  int child_visits = 0;
+  mcts->getRoot().getChildren().forEach(
+      [&](const HiveAction&, int visits, float, auto*) { child_visits += visits; });
+  EXPECT_LE(child_visits, 1000);
+  EXPECT_GT(mcts->getNumNodes(), 1);
+}
+
+// Without virtual loss, a thread may select among children whose playouts are all still running,
+// none of them with a visit. Pruning often makes nodes past minVisits with such children.
+TEST(StrategyTest, SearchThreadsWithoutVirtualLoss) {
+  std::unique_ptr<HiveMCTS> mcts = NewSearch(2000);
+  ActionList actions;
+  GetActionsForBoard(*mcts->getRoot().getData(), &actions);
+  mcts->setThreads(4);
+  mcts->setVirtualLoss(0);
+  mcts->setMinVisits(1);
+  mcts->setMaxNodes(100);
+  std::unique_ptr<HiveAction> action(mcts->calculateAction());
+  EXPECT_THAT(actions, testing::Contains(*action));
+  EXPECT_EQ(mcts->getIterations(), 2000);
+  EXPECT_EQ(mcts->getRoot().getNumVisits(), 2000);
+  EXPECT_GT(mcts->getNumPrunings(), 0);
+}
+
+TEST(StrategyTest, SearchRootParallel) {
+  std::unique_ptr<HiveMCTS> mcts = NewSearch(1000);
+  ActionList actions;
+  GetActionsForBoard(*mcts->getRoot().getData(), &actions);
+  mcts->setThreads(4);
+  mcts->setRootParallel(true);
+  std::unique_ptr<HiveAction> action(mcts->calculateAction());
+  EXPECT_THAT(actions, testing::Contains(*action));
+  EXPECT_EQ(mcts->getIterations(), 1000);
+  // Every action appears once, with the visits of the four trees added up.
+  std::vector<HiveAction> merged;
+  int child_visits = 0;
+  mcts->forEachRootAction([&](const HiveAction& action, int visits, float score) {
+    merged.push_back(action);
+    child_visits += visits;
+    EXPECT_LE(score, visits);
+  });
+  EXPECT_THAT(merged, testing::Contains(*action));
+  EXPECT_EQ(std::unordered_set<HiveAction>(merged.begin(), merged.end()).size(), merged.size());
+  EXPECT_LE(child_visits, 1000);
+}
+
+// The visits and score of every child of the root.
+template <class M>
+std::vector<std::tuple<uint32_t, int, float>> RootStatistics(M* mcts) {
+  std::vector<std::tuple<uint32_t, int, float>> statistics;
+  mcts->forEachRootAction([&](const HiveAction& action, int visits, float score) {
+    statistics.emplace_back(action.bits(), visits, score);
+  });
+  return statistics;
+}
+
+TEST(StrategyTest, SearchWithoutStates) {
+  using HiveNode = Node<HiveState, HiveAction, HiveExpansionStrategy>;
+  for (size_t entries : {0, 1 << 16}) {
+    std::vector<std::unique_ptr<HiveMCTS>> searches;
+    for (bool store_states : {true, false}) {
+      searches.push_back(NewSearch(500));
+      searches.back()->setSeed(9);
+      searches.back()->setTranspositionTableSize(entries);
+      searches.back()->setStoreStates(store_states);
+    }
+    HiveMCTS& stored = *searches[0];
+    HiveMCTS& replayed = *searches[1];
+
+    // Replaying the states gives the same search, without a state below the root.
+    std::unique_ptr<HiveAction> action(stored.calculateAction());
+    std::unique_ptr<HiveAction> replayed_action(replayed.calculateAction());
+    EXPECT_EQ(*replayed_action, *action);
+    EXPECT_EQ(RootStatistics(&replayed), RootStatistics(&stored));
+    EXPECT_EQ(replayed.getNumNodes(), stored.getNumNodes());
+    EXPECT_LT(replayed.getBytesUsed() * 2, stored.getBytesUsed());
+    std::vector<HiveNode*> stack = {&replayed.getRoot()};
+    while (!stack.empty()) {
+      HiveNode* node = stack.back();
+      stack.pop_back();
+      EXPECT_EQ(node->getData() == nullptr, node != &replayed.getRoot());
+      node->getChildren().forEach(
+          [&](const HiveAction&, int, float, HiveNode* child) { stack.push_back(child); });
+    }
+
+    // The new root gets its state back.
+    EXPECT_EQ(replayed.advance(*action), stored.advance(*action));
+    EXPECT_EQ(replayed.getRoot().getData()->Hash(), stored.getRoot().getData()->Hash());
+    action.reset(stored.calculateAction());
+    replayed_action.reset(replayed.calculateAction());
+    EXPECT_EQ(*replayed_action, *action);
+    EXPECT_EQ(RootStatistics(&replayed), RootStatistics(&stored));
+  }
+}
+
+TEST(StrategyTest, SearchBudget) {
+  // Pruning keeps the root's statistics and children, also when pruning a pruned tree.
+  std::unique_ptr<HiveMCTS> mcts = NewSearch(3000);
+  ActionList actions;
+  GetActionsForBoard(*mcts->getRoot().getData(), &actions);
+  mcts->setMaxNodes(400);
+  std::unique_ptr<HiveAction> action(mcts->calculateAction());
+  EXPECT_THAT(actions, testing::Contains(*action));
+  EXPECT_GT(mcts->getNumPrunings(), 1);
+  EXPECT_LE(mcts->getNumNodes(), 400);
+  EXPECT_EQ(mcts->getIterations(), 3000);
+  EXPECT_EQ(mcts->getRoot().getNumVisits(), 3000);
+  EXPECT_EQ(mcts->getRoot().getChildren().size(), actions.size());
+  int child_visits = 0;
+  mcts->getRoot().getChildren().forEach(
+      [&](const HiveAction&, int visits, float, auto*) { child_visits += visits; });
+  EXPECT_GT(child_visits, 3000 - 50);
+  EXPECT_EQ(CountNodes(&mcts->getRoot()), mcts->getNumNodes());
+  EXPECT_GE(mcts->getMemoryUsed(), mcts->getBytesUsed());
+
+  const size_t max_bytes = 400 * sizeof(HiveState);
+  mcts = NewSearch(3000);
+  mcts->setMaxBytes(max_bytes);
+  mcts->setTranspositionTableSize(1 << 10);
+  action.reset(mcts->calculateAction());
+  EXPECT_GT(mcts->getNumPrunings(), 0);
+  EXPECT_LE(mcts->getBytesUsed() + mcts->getTranspositionTableBytes(), max_bytes);
+  EXPECT_EQ(mcts->getRoot().getNumVisits(), 3000);
+
+  // Each thread may expand a node past the budget before they all stop.
+  for (bool root_parallel : {false, true}) {
+    mcts = NewSearch(3000);
+    mcts->setMaxNodes(600);
+    mcts->setThreads(3);
+    mcts->setRootParallel(root_parallel);
+    action.reset(mcts->calculateAction());
+    EXPECT_GT(mcts->getNumPrunings(), 0);
+    EXPECT_LE(mcts->getNumNodes(), 600 + 2);
+    EXPECT_EQ(mcts->getIterations(), 3000);
+  }
+
+  // When the children of the root do not fit, the search stops expanding.
+  mcts = NewSearch(3000);
+  ASSERT_GT(actions.size(), 4);
+  mcts->setMaxNodes(5);
+  action.reset(mcts->calculateAction());
+  EXPECT_EQ(mcts->getNumNodes(), 5);
+  EXPECT_EQ(mcts->getRoot().getNumVisits(), 3000);
+}
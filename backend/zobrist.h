@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+
+#include "backend/enums.h"
+
+namespace hive {
+namespace zobrist {
+
+// Random-looking 64-bit keys for Zobrist hashing. Each key is derived from a unique index with
+// SplitMix64 instead of being looked up in a table of random numbers.
+constexpr uint64_t SplitMix64(uint64_t x) {
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+enum Domain : uint64_t {
+  kPiece = 1,
+  kPieceCount,
+  kCountdown,
+  kImmobile,
+  kWhiteToMove,
+};
+
+constexpr uint64_t Key(Domain domain, uint64_t index) {
+  return SplitMix64(static_cast<uint64_t>(domain) << 32 | index);
+}
+
+// A piece of a side at a given cell and layer.
+constexpr uint64_t PieceKey(PieceType type, Side side, int cell, int z) {
+  return Key(kPiece, static_cast<uint64_t>(cell) | static_cast<uint64_t>(z) << 12 |
+                         static_cast<uint64_t>(type) << 16 | static_cast<uint64_t>(side) << 20);
+}
+
+// Number of spare pieces of a type. Having none contributes nothing.
+constexpr uint64_t PieceCountKey(Side side, PieceType type, int count) {
+  return count == 0 ? 0
+                    : Key(kPieceCount, static_cast<uint64_t>(count) |
+                                           static_cast<uint64_t>(type) << 8 |
+                                           static_cast<uint64_t>(side) << 12);
+}
+
+// Queen placement countdown of a side, from -1 (placed) to 4.
+constexpr uint64_t CountdownKey(Side side, int countdown) {
+  return Key(kCountdown, static_cast<uint64_t>(countdown + 1) | static_cast<uint64_t>(side) << 8);
+}
+
+// Piece at a cell and layer made immobile by a pillbug.
+constexpr uint64_t ImmobileKey(int cell, int z) {
+  return Key(kImmobile, static_cast<uint64_t>(cell) | static_cast<uint64_t>(z) << 12);
+}
+
+constexpr uint64_t WhiteToMoveKey() { return Key(kWhiteToMove, 0); }
+
+}  // namespace zobrist
+}  // namespace hive
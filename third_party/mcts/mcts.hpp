@@ -1,16 +1,38 @@
 // This file is imported from https://github.com/Konijnendijk/cpp-mcts
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
 #include <cstdlib>
 #include <iostream>
 #include <limits>
+#include <memory>
+#include <new>
+#include <optional>
+#include <thread>
+#include <type_traits>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
 #ifndef CPP_MCTS_MCTS_HPP
 #define CPP_MCTS_MCTS_HPP
 
+/** Reading lock-free atomics as plain values is a race ThreadSanitizer reports */
+#if defined(__GNUC__) || defined(__clang__)
+#define MCTS_NO_SANITIZE_THREAD __attribute__((no_sanitize_thread))
+#else
+#define MCTS_NO_SANITIZE_THREAD
+#endif
+
 using namespace std::chrono;
 
 /**
@@ -80,6 +102,108 @@ public:
     virtual ~Action() {};
 };
 
+/**
+ * @brief Pseudo random number generator of a search
+ *
+ * A xoshiro256** generator, seeded through splitmix64. Unlike rand(), it
+ * holds no lock and no state shared between threads, and the numbers it draws
+ * only depend on its seed, so a search with a fixed seed can be reproduced.
+ * Generators of different threads are made from one seed by jump(), which
+ * gives sequences that never overlap.
+ */
+class Random {
+    uint64_t s[4];
+
+    static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+public:
+    explicit Random(uint64_t seed = 0) { setSeed(seed); }
+
+    /**
+     * @brief Restart the sequence of numbers from the given seed
+     */
+    void setSeed(uint64_t seed)
+    {
+        for (uint64_t& word : s) {
+            uint64_t z = (seed += 0x9e3779b97f4a7c15);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+            word = z ^ (z >> 31);
+        }
+    }
+
+    /**
+     * @return 64 uniformly distributed random bits
+     */
+    uint64_t next()
+    {
+        uint64_t result = rotl(s[1] * 5, 7) * 9;
+        uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+    }
+
+    /**
+     * @brief Draw an integer in [0, n) without modulo bias
+     *
+     * Uses Lemire's multiply and shift, which only divides in the rare case
+     * a draw has to be rejected.
+     *
+     * @param n The number of values, at least 1
+     */
+    uint32_t below(uint32_t n)
+    {
+        uint64_t m = (next() >> 32) * n;
+        uint32_t low = static_cast<uint32_t>(m);
+        if (low < n) {
+            uint32_t threshold = -n % n;
+            while (low < threshold) {
+                m = (next() >> 32) * n;
+                low = static_cast<uint32_t>(m);
+            }
+        }
+        return static_cast<uint32_t>(m >> 32);
+    }
+
+    /**
+     * @brief Skip 2^128 numbers ahead
+     *
+     * Copies of one generator, each jumped a different number of times, draw
+     * sequences that do not overlap.
+     */
+    void jump()
+    {
+        static const uint64_t JUMP[] = { 0x180ec6d33cfd0aba, 0xd5a61266f0c9392c,
+            0xa9582618e03fc9aa, 0x39abdc4529b1661c };
+        uint64_t t[4] = { 0, 0, 0, 0 };
+        for (uint64_t jump : JUMP) {
+            for (int b = 0; b < 64; b++) {
+                if (jump & uint64_t(1) << b) {
+                    for (int i = 0; i < 4; i++)
+                        t[i] ^= s[i];
+                }
+                next();
+            }
+        }
+        std::copy(t, t + 4, s);
+    }
+
+    /**
+     * @return The generator of the calling thread, used by strategies not
+     * given one by MCTS
+     */
+    static Random& threadLocal()
+    {
+        thread_local Random random;
+        return random;
+    }
+};
+
 /**
  * @brief Base class for strategies
  *
@@ -91,12 +215,29 @@ protected:
     /** The state a PlayoutStrategy or ExpansionStrategy will act on  */
     T* state;
 
+    /** The random numbers a strategy draws, from the thread running MCTS */
+    Random* random;
+
 public:
     Strategy(T* state)
         : state(state)
+        , random(&Random::threadLocal())
     {
     }
 
+    /**
+     * @brief Act on a copy of the state this strategy was created with
+     */
+    void setState(T* state) { this->state = state; }
+
+    /**
+     * @brief Draw random numbers from the given generator
+     *
+     * MCTS sets the generator of the searching thread before asking for an
+     * Action, strategies must not draw from anything else to be reproducible.
+     */
+    void setRandom(Random* random) { this->random = random; }
+
     virtual ~Strategy() {};
 };
 
@@ -124,12 +265,12 @@ public:
      * @brief Generate the next action in the sequence of possible ones
      *
      * Generate a action that can be performed on Strategy#state and which has not
-     * been returned before by this instance of ExpansionStrategy.
+     * been generated before by this instance of ExpansionStrategy. Only called
+     * when canGenerateNext() is true.
      *
-     * @return An Action that has not been returned before, or nullptr if no such
-     * Action exists
+     * @param action Set to an Action that has not been generated before
      */
-    virtual A* generateNext() = 0;
+    virtual void generateNext(A* action) = 0;
 
     /**
      * @return True if generateNext() can generate a new Action
@@ -255,6 +396,489 @@ public:
     virtual ~Scoring() {}
 };
 
+/**
+ * @brief Whether an Arena may drop objects of type U without running their
+ * destructor
+ *
+ * Defaults to std::is_trivially_destructible. Specialize it as std::true_type
+ * for types whose destructor has no effect, e.g. an ExpansionStrategy whose
+ * members are all trivially destructible, to keep Arena::reset() O(1).
+ */
+template <class U>
+struct ArenaSkipsDestructor : std::is_trivially_destructible<U> {
+};
+
+/**
+ * @brief Bump allocator the search tree is built in
+ *
+ * Objects are carved out of large blocks and only given back all at once by
+ * reset(), so building a tree of millions of nodes costs pointer increments
+ * instead of calls to malloc, and destroying it is O(1). Destructors are
+ * recorded and run by reset() only for the types that need it, see
+ * ArenaSkipsDestructor.
+ */
+class Arena {
+    struct Block {
+        char* data;
+        size_t size;
+    };
+
+    /** Size of the blocks objects are carved out of */
+    static constexpr size_t BLOCK_SIZE = 1 << 20;
+    /** Alignment of the blocks, a cache line */
+    static constexpr size_t BLOCK_ALIGNMENT = 64;
+
+    std::vector<Block> blocks;
+    /** Index in blocks of the block being filled, blocks.size() before the
+     * first allocation */
+    size_t currentBlock = 0;
+    /** Bytes used in the block being filled */
+    size_t offset = 0;
+    /** Bytes handed out since the last reset() */
+    size_t bytesUsed = 0;
+    /** Objects to destroy on reset() */
+    std::vector<std::pair<void (*)(void*), void*>> destructors;
+
+    /** Move to the next block at least minSize large, allocating it if needed */
+    void nextBlock(size_t minSize)
+    {
+        if (currentBlock < blocks.size())
+            currentBlock++;
+        while (currentBlock < blocks.size() && blocks[currentBlock].size < minSize)
+            currentBlock++;
+        if (currentBlock == blocks.size()) {
+            size_t size = std::max(BLOCK_SIZE, minSize);
+            void* data = ::operator new(size, std::align_val_t(BLOCK_ALIGNMENT));
+            blocks.push_back({ static_cast<char*>(data), size });
+        }
+        offset = 0;
+    }
+
+public:
+    Arena() {}
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    /**
+     * @brief Allocate uninitialized memory, valid until reset()
+     * @param size The number of bytes
+     * @param alignment A power of two, at most 64
+     */
+    void* allocate(size_t size, size_t alignment)
+    {
+        size_t start = (offset + alignment - 1) & ~(alignment - 1);
+        if (currentBlock == blocks.size() || start + size > blocks[currentBlock].size) {
+            nextBlock(size);
+            start = 0;
+        }
+        offset = start + size;
+        bytesUsed += size;
+        return blocks[currentBlock].data + start;
+    }
+
+    /**
+     * @brief Construct an object in this arena, valid until reset()
+     */
+    template <class U, class... Args>
+    U* create(Args&&... args)
+    {
+        U* object = new (allocate(sizeof(U), alignof(U))) U(std::forward<Args>(args)...);
+        if (!ArenaSkipsDestructor<U>::value)
+            destructors.emplace_back([](void* p) { static_cast<U*>(p)->~U(); }, object);
+        return object;
+    }
+
+    /**
+     * @brief Destroy every object created, keeping the blocks for reuse
+     */
+    void reset()
+    {
+        for (auto it = destructors.rbegin(); it != destructors.rend(); ++it)
+            it->first(it->second);
+        destructors.clear();
+        currentBlock = 0;
+        offset = 0;
+        bytesUsed = 0;
+    }
+
+    /**
+     * @brief Exchange the objects and blocks of this arena with other
+     */
+    void swap(Arena& other)
+    {
+        blocks.swap(other.blocks);
+        std::swap(currentBlock, other.currentBlock);
+        std::swap(offset, other.offset);
+        std::swap(bytesUsed, other.bytesUsed);
+        destructors.swap(other.destructors);
+    }
+
+    /**
+     * @return The number of bytes handed out since the last reset()
+     */
+    size_t getBytesUsed() const { return bytesUsed; }
+
+    /**
+     * @return The number of bytes held in blocks
+     */
+    size_t getBytesReserved() const
+    {
+        size_t bytes = 0;
+        for (const Block& block : blocks)
+            bytes += block.size;
+        return bytes;
+    }
+
+    ~Arena()
+    {
+        reset();
+        for (const Block& block : blocks)
+            ::operator delete(block.data, std::align_val_t(BLOCK_ALIGNMENT));
+    }
+};
+
+/**
+ * @brief Finds the child with the highest UCT value among arrays of statistics
+ *
+ * The UCT value of a child is score / visits + C * sqrt(logParentVisits /
+ * visits), visits must be positive. The log of the parent's visits is computed
+ * once by the caller. Children are scanned 8 at a time with AVX2, 4 at a time
+ * with SSE2, the rest one by one. Each SIMD lane keeps its own maximum across
+ * calls to scan(), lanes are only merged by getIndex().
+ */
+class UctArgmax {
+#if defined(__AVX2__)
+    static constexpr int LANES = 8;
+    using Floats = __m256;
+    using Ints = __m256i;
+#elif defined(__SSE2__)
+    static constexpr int LANES = 4;
+    using Floats = __m128;
+    using Ints = __m128i;
+#endif
+
+    float logParentVisits;
+    float C;
+    /** Maximum of the children scanned one by one */
+    float best = -std::numeric_limits<float>::max();
+    int bestIndex = -1;
+#if defined(__AVX2__) || defined(__SSE2__)
+    Floats laneBest;
+    Ints laneIndex;
+#endif
+
+public:
+    UctArgmax(float logParentVisits, float C)
+        : logParentVisits(logParentVisits)
+        , C(C)
+    {
+#if defined(__AVX2__)
+        laneBest = _mm256_set1_ps(best);
+        laneIndex = _mm256_set1_epi32(-1);
+#elif defined(__SSE2__)
+        laneBest = _mm_set1_ps(best);
+        laneIndex = _mm_set1_epi32(-1);
+#endif
+    }
+
+    /**
+     * @brief Scan count children whose indices start at firstIndex
+     *
+     * The arrays may be updated by other threads meanwhile, see
+     * ChildArray::selectUCT(), hence the statistics of a child may be one
+     * update behind.
+     */
+    MCTS_NO_SANITIZE_THREAD
+    void scan(const int* visits, const float* scores, int count, int firstIndex)
+    {
+        int i = 0;
+#if defined(__AVX2__)
+        const Floats logN = _mm256_set1_ps(logParentVisits);
+        const Floats c = _mm256_set1_ps(C);
+        Ints index = _mm256_add_epi32(
+            _mm256_set1_epi32(firstIndex), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+        for (; i + LANES <= count; i += LANES) {
+            Floats n = _mm256_cvtepi32_ps(
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(visits + i)));
+            Floats value = _mm256_add_ps(_mm256_div_ps(_mm256_loadu_ps(scores + i), n),
+                _mm256_mul_ps(c, _mm256_sqrt_ps(_mm256_div_ps(logN, n))));
+            Floats greater = _mm256_cmp_ps(value, laneBest, _CMP_GT_OQ);
+            laneBest = _mm256_blendv_ps(laneBest, value, greater);
+            laneIndex = _mm256_castps_si256(_mm256_blendv_ps(
+                _mm256_castsi256_ps(laneIndex), _mm256_castsi256_ps(index), greater));
+            index = _mm256_add_epi32(index, _mm256_set1_epi32(LANES));
+        }
+#elif defined(__SSE2__)
+        const Floats logN = _mm_set1_ps(logParentVisits);
+        const Floats c = _mm_set1_ps(C);
+        Ints index = _mm_add_epi32(_mm_set1_epi32(firstIndex), _mm_setr_epi32(0, 1, 2, 3));
+        for (; i + LANES <= count; i += LANES) {
+            Floats n
+                = _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(visits + i)));
+            Floats value = _mm_add_ps(_mm_div_ps(_mm_loadu_ps(scores + i), n),
+                _mm_mul_ps(c, _mm_sqrt_ps(_mm_div_ps(logN, n))));
+            Floats greater = _mm_cmpgt_ps(value, laneBest);
+            Ints greaterMask = _mm_castps_si128(greater);
+            laneBest = _mm_or_ps(_mm_and_ps(greater, value), _mm_andnot_ps(greater, laneBest));
+            laneIndex = _mm_or_si128(
+                _mm_and_si128(greaterMask, index), _mm_andnot_si128(greaterMask, laneIndex));
+            index = _mm_add_epi32(index, _mm_set1_epi32(LANES));
+        }
+#endif
+        for (; i < count; i++) {
+            float n = static_cast<float>(visits[i]);
+            float value = scores[i] / n + C * std::sqrt(logParentVisits / n);
+            if (value > best) {
+                best = value;
+                bestIndex = firstIndex + i;
+            }
+        }
+    }
+
+    /**
+     * @param bestValue Set to the highest UCT value
+     * @return The index of the highest UCT value scanned, the first one on ties,
+     * -1 if nothing was scanned
+     */
+    int getIndex(float* bestValue)
+    {
+        float value = best;
+        int index = bestIndex;
+#if defined(__AVX2__) || defined(__SSE2__)
+        alignas(32) float values[LANES];
+        alignas(32) int indices[LANES];
+#if defined(__AVX2__)
+        _mm256_store_ps(values, laneBest);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(indices), laneIndex);
+#else
+        _mm_store_ps(values, laneBest);
+        _mm_store_si128(reinterpret_cast<__m128i*>(indices), laneIndex);
+#endif
+        // Each lane kept its first maximum, the earliest of the maxima wins ties.
+        for (int lane = 0; lane < LANES; lane++) {
+            if (indices[lane] < 0)
+                continue;
+            if (index < 0 || values[lane] > value
+                || (values[lane] == value && indices[lane] < index)) {
+                value = values[lane];
+                index = indices[lane];
+            }
+        }
+#endif
+        *bestValue = value;
+        return index;
+    }
+};
+
+/**
+ * @brief Index of the child with the highest UCT value in arrays of count
+ * children, see UctArgmax
+ *
+ * @param bestValue Set to the highest UCT value
+ * @return The index of the highest UCT value, the first one on ties, -1 if
+ * count is 0
+ */
+inline int uctArgmax(const int* visits, const float* scores, int count, float logParentVisits,
+    float C, float* bestValue)
+{
+    UctArgmax argmax(logParentVisits, C);
+    argmax.scan(visits, scores, count, 0);
+    return argmax.getIndex(bestValue);
+}
+
+/**
+ * @brief Add to an atomic float
+ */
+inline void atomicAdd(std::atomic<float>& target, float value)
+{
+    float expected = target.load(std::memory_order_relaxed);
+    while (!target.compare_exchange_weak(expected, expected + value, std::memory_order_relaxed)) {
+    }
+}
+
+/**
+ * @brief Statistics and actions of the children of a node, stored as arrays
+ *
+ * Visit counts, score sums, actions and nodes of the children are kept in
+ * separate arrays, in blocks of BLOCK_SIZE children created in an Arena.
+ * Selection scans the visit and score arrays of a block without touching the
+ * child nodes. Blocks never move, so a child reaches its own statistics
+ * through a Slot.
+ *
+ * Statistics are atomics updated with relaxed ordering. add() is called by
+ * one thread at a time, see Node::tryLock(), while other threads read: a child
+ * is published by a release store of the counts once its fields are written.
+ *
+ * @tparam A The type of Action taken to get to a child
+ * @tparam N The type of the child nodes
+ */
+template <class A, class N>
+class ChildArray {
+public:
+    static constexpr int BLOCK_SIZE = 16;
+
+    static_assert(std::atomic<int>::is_always_lock_free
+            && std::atomic<float>::is_always_lock_free
+            && sizeof(std::atomic<int>) == sizeof(int)
+            && sizeof(std::atomic<float>) == sizeof(float),
+        "selectUCT() reads the statistics as plain arrays");
+
+    struct alignas(64) Block {
+        std::atomic<int> visits[BLOCK_SIZE];
+        std::atomic<float> scores[BLOCK_SIZE];
+        A actions[BLOCK_SIZE];
+        N* nodes[BLOCK_SIZE];
+        std::atomic<Block*> next{ nullptr };
+        std::atomic<int> count{ 0 };
+    };
+
+    /**
+     * @brief Where the statistics and action of one child are stored
+     */
+    struct Slot {
+        Block* block = nullptr;
+        int index = 0;
+
+        std::atomic<int>& visits() const { return block->visits[index]; }
+        std::atomic<float>& score() const { return block->scores[index]; }
+        const A& action() const { return block->actions[index]; }
+
+        /**
+         * @brief Add score and visits to the statistics of the child
+         */
+        void update(float score, int visits) const
+        {
+            atomicAdd(this->score(), score);
+            this->visits().fetch_add(visits, std::memory_order_relaxed);
+        }
+    };
+
+private:
+    std::atomic<Block*> first{ nullptr };
+    Block* last = nullptr;
+    std::atomic<int> count{ 0 };
+
+public:
+    /**
+     * @brief Add a child with no score
+     * @param visits The initial number of visits, see MCTS::setVirtualLoss()
+     * @param createNode Called with the Slot of the new child, returns the
+     * child node
+     * @return The child node
+     */
+    template <class F>
+    N* add(Arena& arena, const A& action, int visits, F&& createNode)
+    {
+        if (last == nullptr || last->count.load(std::memory_order_relaxed) == BLOCK_SIZE) {
+            Block* block = arena.create<Block>();
+            if (last)
+                last->next.store(block, std::memory_order_release);
+            else
+                first.store(block, std::memory_order_release);
+            last = block;
+        }
+        Slot slot{ last, last->count.load(std::memory_order_relaxed) };
+        slot.visits().store(visits, std::memory_order_relaxed);
+        slot.score().store(0, std::memory_order_relaxed);
+        last->actions[slot.index] = action;
+        N* node = createNode(slot);
+        last->nodes[slot.index] = node;
+        last->count.store(slot.index + 1, std::memory_order_release);
+        count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        return node;
+    }
+
+    /**
+     * @return The number of children
+     */
+    int size() const { return count.load(std::memory_order_acquire); }
+
+    /**
+     * @return The i-th child added, i must be below a value returned by size()
+     */
+    N* get(int i) const
+    {
+        Slot slot;
+        return get(i, &slot);
+    }
+
+    /**
+     * @brief Same as get(i), also setting slot to where the statistics of the
+     * child are
+     */
+    N* get(int i, Slot* slot) const
+    {
+        Block* block = first.load(std::memory_order_acquire);
+        for (; i >= BLOCK_SIZE; i -= BLOCK_SIZE)
+            block = block->next.load(std::memory_order_acquire);
+        *slot = Slot{ block, i };
+        return block->nodes[i];
+    }
+
+    /**
+     * @return The child with the highest UCT value, the first one on ties
+     */
+    N* selectUCT(float logParentVisits, float C) const
+    {
+        int index = selectUCTIndex(logParentVisits, C);
+        return index < 0 ? nullptr : get(index);
+    }
+
+    /**
+     * @return The index of the child with the highest UCT value, the first one
+     * on ties, -1 without children or if no child has visits
+     */
+    int selectUCTIndex(float logParentVisits, float C) const
+    {
+        UctArgmax argmax(logParentVisits, C);
+        int firstIndex = 0;
+        for (Block* block = first.load(std::memory_order_acquire); block != nullptr;
+             block = block->next.load(std::memory_order_acquire)) {
+            int n = block->count.load(std::memory_order_acquire);
+            // Vector loads of the lock-free atomics, each lane is read whole.
+            // Copying them to plain arrays first costs more than the scan.
+            argmax.scan(reinterpret_cast<const int*>(block->visits),
+                reinterpret_cast<const float*>(block->scores), n, firstIndex);
+            firstIndex += BLOCK_SIZE;
+        }
+        float value;
+        return argmax.getIndex(&value);
+    }
+
+    /**
+     * @return The child with the highest average score, the first one on ties
+     */
+    N* selectBestAverage() const
+    {
+        N* best = nullptr;
+        float bestScore = -std::numeric_limits<float>::max();
+        forEach([&](const A&, int visits, float score, N* node) {
+            if (score / visits > bestScore) {
+                bestScore = score / visits;
+                best = node;
+            }
+        });
+        return best;
+    }
+
+    /**
+     * @brief Call f(action, visits, score, node) for every child, in the order
+     * they were added
+     */
+    template <class F>
+    void forEach(F&& f) const
+    {
+        for (Block* block = first.load(std::memory_order_acquire); block != nullptr;
+             block = block->next.load(std::memory_order_acquire)) {
+            int n = block->count.load(std::memory_order_acquire);
+            for (int i = 0; i < n; i++) {
+                f(block->actions[i], block->visits[i].load(std::memory_order_relaxed),
+                    block->scores[i].load(std::memory_order_relaxed), block->nodes[i]);
+            }
+        }
+    }
+};
+
 /**
  * @brief Class used in the internal data structure of MCTS
  *
@@ -262,42 +886,65 @@ public:
  * of its score and the number of times it has been visited. Furthermore it is
  * used to generate new nodes according to the ExpansionStrategy E.
  *
+ * Nodes, their states and their ExpansionStrategy are created in the Arena of
+ * the MCTS instance and are never destroyed one by one. The score, visits and
+ * action of a node are stored in the ChildArray of its parent, see
+ * ChildArray::Slot.
+ *
+ * Several threads may search a tree: statistics are atomics, and a node is
+ * expanded by the thread holding its lock, see tryLock().
+ *
+ * With transpositions, see MCTS::setTranspositionTableSize(), a node reached
+ * by several paths is shared by them. It is then a child of several parents,
+ * each storing the statistics of its own edge, while the node also adds up
+ * the scores of every playout through it, see getTotalScore().
+ *
+ * Without stored States, see MCTS::setStoreStates(), only the root holds a
+ * State, the others are rebuilt from the actions on the path to them.
+ *
  * @tparam T The State type that is stored in a node
  * @tparam A The type of Action taken to get to this node
  * @tparam E The ExpansionStrategy to use when generating new nodes
  */
 template <class T, class A, class E>
 class Node {
+public:
+    using Children = ChildArray<A, Node<T, A, E>>;
+
+private:
     unsigned int id;
     T* data;
     Node<T, A, E>* parent;
-    std::vector<Node<T, A, E>*> children;
-    /** Action done to get from the parent to this node */
-    A* action;
-    ExpansionStrategy<T, A>* expansion;
-    int numVisits;
-    float score;
+    Children children;
+    /** Score, visits and action done to get from the parent to this node */
+    typename Children::Slot slot;
+    /** Playouts through this node by any path, with transpositions only */
+    std::atomic<int> totalVisits{ 0 };
+    /** Sum of the scores of these playouts, before Backpropagation */
+    std::atomic<float> totalScore{ 0 };
+    /** Set once a second parent links to this node */
+    std::atomic<bool> shared{ false };
+    /** Created on the first expansion, most nodes never get one */
+    E* expansion = nullptr;
+    /** Set once the ExpansionStrategy generated every Action */
+    std::atomic<bool> fullyExpanded{ false };
+    /** Held by the thread expanding this node */
+    std::atomic<bool> locked{ false };
 
 public:
     /**
      * @brief Create a new node in the search tree
      *
-     * This constructor initializes the nodes and creates a new instance of the
-     * ExpansionStrategy passed as template parameter E.
-     *
      * @param id An identifier unique to the tree this node is in
-     * @param data The state stored in this node
+     * @param data The state stored in this node, nullptr if not stored
      * @param parent The parent node
-     * @param action The action taken to get to this node from the parent node
+     * @param slot Where the parent stores the statistics of this node
      */
-    Node(unsigned int id, T* data, Node<T, A, E>* parent, A* action)
+    Node(unsigned int id, T* data, Node<T, A, E>* parent, typename Children::Slot slot)
         : id(id)
         , data(data)
         , parent(parent)
-        , action(action)
-        , expansion(new E(data))
-        , numVisits(0)
-        , score(0) {};
+        , slot(slot) {};
 
     /**
      * @return The unique ID of this node
@@ -305,7 +952,8 @@ public:
     unsigned int getID() { return id; }
 
     /**
-     * @return The State associated with this Node
+     * @return The State associated with this Node, nullptr for a Node other
+     * than the root when MCTS does not store States
      */
     T* getData() { return data; }
 
@@ -318,64 +966,245 @@ public:
     /**
      * @return All children of this Node
      */
-    std::vector<Node<T, A, E>*>& getChildren() { return children; }
+    Children& getChildren() { return children; }
 
     /**
      * @return The Action to execute on the parent's State to get from the
      * parent's State to this Node's State.
      */
-    A* getAction() { return action; }
+    const A& getAction() { return slot.action(); }
+
+    /**
+     * @return The ExpansionStrategy of this Node, nullptr until setExpansion()
+     */
+    E* getExpansion() { return expansion; }
+
+    /**
+     * @brief Set the ExpansionStrategy generating the children of this Node
+     */
+    void setExpansion(E* expansion) { this->expansion = expansion; }
+
+    /**
+     * @brief Take the lock guarding the expansion of this Node, without waiting
+     * @return True if the lock was taken, false if another thread holds it
+     */
+    bool tryLock() { return !locked.exchange(true, std::memory_order_acquire); }
 
     /**
-     * @return A new action if there are any remaining, nullptr if not
+     * @brief Release the lock taken by tryLock()
      */
-    A* generateNextAction() { return expansion->generateNext(); }
+    void unlock() { locked.store(false, std::memory_order_release); }
 
     /**
-     * @brief Add a child to this Node's children
-     * @param child The child to add
+     * @brief Record that the ExpansionStrategy cannot generate more Actions
      */
-    void addChild(Node<T, A, E>* child) { children.push_back(child); }
+    void setFullyExpanded() { fullyExpanded.store(true, std::memory_order_release); }
 
     /**
      * @brief Checks this Node's ActionGenerator if there are more Actions to be
      * generated.
      * @return True if it is still possible to add children
      */
-    bool shouldExpand()
-    {
-        bool result = children.empty() || expansion->canGenerateNext();
-        return result;
-    }
+    bool shouldExpand() { return !fullyExpanded.load(std::memory_order_acquire); }
+
+    /**
+     * @return Where the parent that created this Node stores its statistics
+     */
+    const typename Children::Slot& getSlot() { return slot; }
 
     /**
      * @brief Update this Node's score and increment the number of visits.
      * @param score
+     * @param visits The number of visits to add, less than 1 when virtual
+     * loss was already added on the way down
      */
-    void update(float score)
+    void update(float score, int visits = 1) { slot.update(score, visits); }
+
+    /**
+     * @brief Add a playout through any path to the totals of this Node
+     * @param score The score of the playout, before Backpropagation
+     */
+    void addTotal(float score)
     {
-        this->score += score;
-        numVisits++;
+        atomicAdd(totalScore, score);
+        totalVisits.fetch_add(1, std::memory_order_relaxed);
     }
 
+    /**
+     * @brief Set the totals of this Node, e.g. when copying it
+     */
+    void setTotal(float score, int visits)
+    {
+        totalScore.store(score, std::memory_order_relaxed);
+        totalVisits.store(visits, std::memory_order_relaxed);
+    }
+
+    /**
+     * @return The sum of the scores given to addTotal()
+     */
+    float getTotalScore() { return totalScore.load(std::memory_order_relaxed); }
+
+    /**
+     * @return The number of calls to addTotal()
+     */
+    int getTotalVisits() { return totalVisits.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Record that this Node has more than one parent
+     */
+    void setShared() { shared.store(true, std::memory_order_relaxed); }
+
+    /**
+     * @return True if this Node has more than one parent
+     */
+    bool isShared() { return shared.load(std::memory_order_relaxed); }
+
     /**
      * @return The total score divided by the number of visits.
      */
-    float getAvgScore() { return score / numVisits; }
+    float getAvgScore()
+    {
+        return slot.score().load(std::memory_order_relaxed)
+            / slot.visits().load(std::memory_order_relaxed);
+    }
 
     /**
      * @return The number of times updateScore(score) was called
      */
-    int getNumVisits() { return numVisits; }
+    int getNumVisits() { return slot.visits().load(std::memory_order_relaxed); }
+};
+
+/**
+ * @brief Maps the hash of a State to the Node holding it
+ *
+ * Entries are stored in buckets of WAYS, each guarded by a spin lock. When a
+ * bucket is full, the entry whose node has the fewest total visits is
+ * replaced: the node stays in the tree, but other paths no longer find it. The
+ * table never grows past the number of entries it was created with.
+ *
+ * @tparam N The type of the nodes, see Node
+ */
+template <class N>
+class TranspositionTable {
+public:
+    static constexpr int WAYS = 4;
+
+private:
+    struct Bucket {
+        std::atomic<bool> locked{ false };
+        int count = 0;
+        uint64_t keys[WAYS];
+        N* nodes[WAYS];
+    };
+
+    std::unique_ptr<Bucket[]> buckets;
+    size_t numBuckets = 1;
+    std::atomic<uint64_t> lookups{ 0 };
+    std::atomic<uint64_t> hits{ 0 };
+    std::atomic<uint64_t> replacements{ 0 };
+
+public:
+    /**
+     * @param entries The number of entries, rounded up to a power of two
+     */
+    explicit TranspositionTable(size_t entries)
+    {
+        while (numBuckets * WAYS < entries)
+            numBuckets *= 2;
+        buckets.reset(new Bucket[numBuckets]);
+    }
+
+    /**
+     * @brief Find the node of key, or insert the one returned by create()
+     *
+     * create() is called while the bucket of key is locked, so a State is never
+     * inserted twice.
+     *
+     * @param found Set to true if the node was found
+     * @return The node found or created
+     */
+    template <class F>
+    N* findOrInsert(uint64_t key, F&& create, bool* found)
+    {
+        lookups.fetch_add(1, std::memory_order_relaxed);
+        Bucket& bucket = buckets[key & (numBuckets - 1)];
+        while (bucket.locked.exchange(true, std::memory_order_acquire))
+            std::this_thread::yield();
+
+        for (int i = 0; i < bucket.count; i++) {
+            if (bucket.keys[i] == key) {
+                N* node = bucket.nodes[i];
+                bucket.locked.store(false, std::memory_order_release);
+                hits.fetch_add(1, std::memory_order_relaxed);
+                *found = true;
+                return node;
+            }
+        }
+
+        N* node = create();
+        int i = bucket.count;
+        if (i < WAYS) {
+            bucket.count++;
+        } else {
+            i = 0;
+            for (int j = 1; j < WAYS; j++) {
+                if (bucket.nodes[j]->getTotalVisits() < bucket.nodes[i]->getTotalVisits())
+                    i = j;
+            }
+            replacements.fetch_add(1, std::memory_order_relaxed);
+        }
+        bucket.keys[i] = key;
+        bucket.nodes[i] = node;
+        bucket.locked.store(false, std::memory_order_release);
+        *found = false;
+        return node;
+    }
+
+    /**
+     * @brief Insert node for key, unless key is already present
+     */
+    void insert(uint64_t key, N* node)
+    {
+        bool found;
+        findOrInsert(key, [node]() { return node; }, &found);
+    }
 
-    ~Node()
+    /**
+     * @brief Remove every entry and reset the counters
+     */
+    void clear()
     {
-        delete data;
-        delete action;
-        delete expansion;
-        for (Node<T, A, E>* child : children)
-            delete child;
+        for (size_t i = 0; i < numBuckets; i++)
+            buckets[i].count = 0;
+        lookups = 0;
+        hits = 0;
+        replacements = 0;
     }
+
+    /**
+     * @return The number of calls to findOrInsert()
+     */
+    uint64_t getLookups() const { return lookups.load(std::memory_order_relaxed); }
+
+    /**
+     * @return The number of calls to findOrInsert() that found the key
+     */
+    uint64_t getHits() const { return hits.load(std::memory_order_relaxed); }
+
+    /**
+     * @return The number of entries dropped to make room for another
+     */
+    uint64_t getReplacements() const { return replacements.load(std::memory_order_relaxed); }
+
+    /**
+     * @return The number of entries the table can hold
+     */
+    size_t getCapacity() const { return numBuckets * WAYS; }
+
+    /**
+     * @return The number of bytes taken by the entries
+     */
+    size_t getBytes() const { return numBuckets * sizeof(Bucket); }
 };
 
 /**
@@ -409,6 +1238,52 @@ public:
  *
  * The time that MCTS is allowed to search van be set by MCTS::setTime().
  *
+ * The whole tree lives in Arenas, freed at once when this MCTS instance is
+ * destroyed. Its size is reported by MCTS::getNumNodes() and
+ * MCTS::getBytesUsed().
+ *
+ * Several threads can search the same tree, see MCTS::setThreads(). Each
+ * thread creates nodes in its own Arena. A virtual loss is added to the nodes
+ * a thread selects until its playout is backpropagated, so that other threads
+ * pick different paths, see MCTS::setVirtualLoss(). A node is expanded by one
+ * thread at a time, a thread finding it busy runs its playout from that node.
+ * The Backpropagation, TerminationCheck and Scoring must then be safe to call
+ * from several threads.
+ *
+ * In root parallel mode, see MCTS::setRootParallel(), each thread searches a
+ * tree of its own from a copy of the root State instead, sharing nothing but
+ * the iteration count. The statistics of the children of the roots are added
+ * up by Action before choosing, which needs std::hash and operator== for A.
+ *
+ * With a transposition table, see MCTS::setTranspositionTableSize(), States
+ * reached by different paths share one Node, found by std::hash<T>. The tree
+ * becomes a directed acyclic graph: the hash must tell apart States the game
+ * may go on differently from, and no State may be reachable from itself, e.g.
+ * by including the number of actions played. Expanding to a State already in
+ * the table links to its Node and backpropagates its average score instead of
+ * running a playout. The edges to a shared Node keep their own visits, which
+ * drive exploration, but their score is set to the average of every playout
+ * through the Node, so UCT sees what all paths learnt.
+ *
+ * Every Node stores its State by default. With MCTS::setStoreStates(false),
+ * only the root does, and the search replays the Actions from the root State
+ * to get the States it needs: a Node then takes little more than its Action
+ * and statistics, and the tree holds many more nodes in the same memory, for
+ * some time spent replaying. Actions are executed on a State they did not
+ * create, so A::execute() must only depend on the State given.
+ *
+ * The tree can be given a budget of nodes and bytes, see MCTS::setMaxNodes()
+ * and MCTS::setMaxBytes(). When the search reaches it, every thread stops
+ * and the tree is pruned: the nodes with the fewest visits lose their
+ * subtree and become leaves again, and the rest is copied to fresh storage.
+ * The children of the root are always kept. If that cannot make room, the
+ * search goes on without expanding.
+ *
+ * Random selection and the strategies draw from a Random generator per
+ * thread, made from one seed, see MCTS::setSeed(). The strategies get it by
+ * Strategy::setRandom(). A search with one thread and a minimum number of
+ * iterations is then reproduced exactly from the same seed.
+ *
  * @tparam T The State type this MCTS operates on
  * @tparam A The Action type this MCTS operates on
  * @tparam E The ExpansionStrategy this MCTS uses
@@ -435,11 +1310,43 @@ class MCTS {
      * randomly */
     const int DEFAULT_MIN_VISITS = 5;
 
+    /** Default number of threads searching the tree */
+    const int DEFAULT_THREADS = 1;
+
+    /** Default number of visits added to a selected node until backpropagation */
+    const int DEFAULT_VIRTUAL_LOSS = 1;
+
+    /** Default seed of the random number generators */
+    static constexpr uint64_t DEFAULT_SEED = 0;
+
+    /** Share of the budget the tree is pruned down to */
+    static constexpr double PRUNE_FRACTION = 0.5;
+
     Backpropagation<T>* backprop;
     TerminationCheck<T>* termination;
     Scoring<T>* scoring;
 
-    Node<T, A, E> root;
+    /** Holds the root and the nodes created by the first thread */
+    Arena arena;
+
+    /** Hold the nodes created by the other threads, one Arena per thread */
+    std::vector<std::unique_ptr<Arena>> workerArenas;
+
+    /** A tree searched by one of the other threads in root parallel mode */
+    struct RootTree {
+        Arena arena;
+        typename Node<T, A, E>::Children* rootSlot = nullptr;
+        Node<T, A, E>* root = nullptr;
+        std::unique_ptr<TranspositionTable<Node<T, A, E>>> table;
+    };
+
+    /** The trees of the other threads in root parallel mode */
+    std::vector<std::unique_ptr<RootTree>> rootTrees;
+
+    T* rootData;
+    /** Holds the statistics of the root, which has no parent */
+    typename Node<T, A, E>::Children* rootSlot;
+    Node<T, A, E>* root;
 
     /** The time MCTS is allowed to search */
     milliseconds time = milliseconds(DEFAULT_TIME);
@@ -460,22 +1367,72 @@ class MCTS {
      * formula, below this number random selection is used */
     int minVisits = DEFAULT_MIN_VISITS;
 
+    /** Number of threads searching the tree */
+    int threads = DEFAULT_THREADS;
+
+    /** Visits added to a selected node until backpropagation when searching
+     * with several threads */
+    int virtualLoss = DEFAULT_VIRTUAL_LOSS;
+
+    /** If each thread searches its own tree */
+    bool rootParallel = false;
+
+    /** If every Node stores its State, otherwise only the roots do */
+    bool storeStates = true;
+
+    /** Number of entries of the transposition table, 0 without */
+    size_t transpositionEntries = 0;
+
+    /** Maps States to their Node in the tree of the calling thread */
+    std::unique_ptr<TranspositionTable<Node<T, A, E>>> table;
+
+    /** Seed the random number generators are made from */
+    uint64_t seed = DEFAULT_SEED;
+
+    /** One random number generator per thread, the calling thread's first.
+     * They go on from one search to the next. */
+    std::vector<Random> randoms;
+
+    /** Maximum number of nodes in the trees, 0 for no limit */
+    unsigned int maxNodes = 0;
+
+    /** Maximum number of bytes used by the trees and the transposition
+     * tables, 0 for no limit */
+    size_t maxBytes = 0;
+
+    /** Bytes used by the trees, kept up to date by the searching threads */
+    std::atomic<size_t> treeBytes{ 0 };
+
+    /** Set by a thread reaching the budget, stops every thread until the
+     * tree is pruned */
+    std::atomic<bool> pruneRequested{ false };
+
+    /** Set when pruning could not make room, the search then stops expanding */
+    bool expansionStopped = false;
+
+    /** The number of times the trees were pruned */
+    unsigned int numPrunings = 0;
+
     /** Variable to assign IDs to a node */
-    unsigned int currentNodeID = 0;
+    std::atomic<unsigned int> currentNodeID{ 0 };
 
     /** The number of search iterations so far */
-    unsigned int iterations = 0;
+    std::atomic<unsigned int> iterations{ 0 };
 
 public:
     /**
-     * @note backprop, termination and scoring will be deleted by this MCTS
-     * instance
+     * @note rootData, backprop, termination and scoring will be deleted by this
+     * MCTS instance
      */
     MCTS(T* rootData, Backpropagation<T>* backprop, TerminationCheck<T>* termination, Scoring<T>* scoring)
         : backprop(backprop)
         , termination(termination)
         , scoring(scoring)
-        , root(0, rootData, 0, new A())
+        , rootData(rootData)
+        , rootSlot(arena.create<typename Node<T, A, E>::Children>())
+        , root(rootSlot->add(arena, A(), 0, [&](typename Node<T, A, E>::Children::Slot slot) {
+            return arena.create<Node<T, A, E>>(0, rootData, nullptr, slot);
+        }))
     {
     }
 
@@ -489,19 +1446,103 @@ public:
         search();
 
         // Select the Action with the best score
-        Node<T, A, E>* best = nullptr;
+        if (rootTrees.empty()) {
+            Node<T, A, E>* best = root->getChildren().selectBestAverage();
+            return new A(best->getAction());
+        }
+        A best;
         float bestScore = -std::numeric_limits<float>::max();
-        std::vector<Node<T, A, E>*>& children = root.getChildren();
+        forEachRootAction([&](const A& action, int visits, float score) {
+            if (score / visits > bestScore) {
+                bestScore = score / visits;
+                best = action;
+            }
+        });
+        return new A(best);
+    }
 
-        for (unsigned int i = 0; i < children.size(); i++) {
-            float score = children[i]->getAvgScore();
-            if (score > bestScore) {
-                bestScore = score;
-                best = children[i];
+    /**
+     * @brief Make the child of the root reached by action the new root
+     *
+     * Call it with the Action played, then with the reply, to search the next
+     * turn from the subtree already explored. The subtree of that child is
+     * copied to fresh storage, its visits and scores included, and the rest of
+     * the tree is freed. An Action that was never expanded gives a new root
+     * without children. In root parallel mode, only the tree of the calling
+     * thread is kept. The iteration count starts over.
+     *
+     * @return The number of nodes kept, the new root included
+     */
+    unsigned int advance(const A& action)
+    {
+        Node<T, A, E>* next = nullptr;
+        int nextVisits = 0;
+        float nextScore = 0;
+        root->getChildren().forEach([&](const A& childAction, int visits, float score,
+                                        Node<T, A, E>* child) {
+            if (next == nullptr && childAction == action) {
+                next = child;
+                nextVisits = visits;
+                nextScore = score;
             }
+        });
+
+        T* nextData;
+        if (next != nullptr && next->getData() != nullptr) {
+            nextData = new T(*next->getData());
+        } else {
+            nextData = new T(*rootData);
+            A(action).execute(nextData);
         }
 
-        return new A(*best->getAction());
+        Arena kept;
+        CopyTarget target(kept, table.get());
+        rootSlot = kept.create<typename Node<T, A, E>::Children>();
+        if (table)
+            table->clear();
+        root = copySubtree(
+            next, target, nextData, nextData, nullptr, *rootSlot, action, nextVisits, nextScore);
+        arena.swap(kept);
+
+        delete rootData;
+        rootData = nextData;
+        for (const std::unique_ptr<Arena>& a : workerArenas)
+            a->reset();
+        rootTrees.clear();
+        currentNodeID = target.numNodes - 1;
+        iterations = 0;
+        return target.numNodes;
+    }
+
+    /**
+     * @brief Call f(action, visits, score) for every child of the root
+     *
+     * In root parallel mode, the visits and scores of the children with the
+     * same Action in every tree are added up.
+     */
+    template <class F>
+    void forEachRootAction(F&& f)
+    {
+        std::unordered_map<A, size_t> indices;
+        std::vector<A> actions;
+        std::vector<int> visits;
+        std::vector<float> scores;
+        auto merge = [&](const A& action, int childVisits, float score, Node<T, A, E>*) {
+            auto inserted = indices.emplace(action, actions.size());
+            if (inserted.second) {
+                actions.push_back(action);
+                visits.push_back(childVisits);
+                scores.push_back(score);
+            } else {
+                visits[inserted.first->second] += childVisits;
+                scores[inserted.first->second] += score;
+            }
+        };
+        root->getChildren().forEach(merge);
+        for (const std::unique_ptr<RootTree>& tree : rootTrees)
+            tree->root->getChildren().forEach(merge);
+        for (size_t i = 0; i < actions.size(); i++)
+            f(actions[i], visits[i], scores[i]);
     }
 
     /**
@@ -546,121 +1587,684 @@ public:
      */
     void setMinIterations(int i) { this->minIterations = i; }
 
+    /**
+     * @brief Set the number of threads searching the tree in parallel
+     *
+     * The calling thread is one of them.
+     *
+     * @param threads The number of threads, at least 1
+     */
+    void setThreads(int threads) { this->threads = std::max(threads, 1); }
+
+    /**
+     * @brief Set the virtual loss used when searching with several threads
+     *
+     * A node selected by a thread counts this many more visits, without
+     * score, until the playout through it is backpropagated. Its UCT value
+     * drops meanwhile and other threads select other paths. It is not used by
+     * a search with one thread.
+     *
+     * @param virtualLoss The number of visits, 0 to disable
+     */
+    void setVirtualLoss(int virtualLoss) { this->virtualLoss = virtualLoss; }
+
+    /**
+     * @brief Have each thread search a tree of its own
+     *
+     * The threads set by setThreads() then never touch the same node, and
+     * the statistics of their roots are merged by calculateAction(). getRoot()
+     * gives the tree of the calling thread.
+     *
+     * @param rootParallel True for one tree per thread, false to share one
+     * tree
+     */
+    void setRootParallel(bool rootParallel) { this->rootParallel = rootParallel; }
+
+    /**
+     * @brief Choose whether every Node stores its State
+     *
+     * Without, only the root stores its State, and the States of the other
+     * nodes are replayed from it by executing the Actions on the path, once
+     * on the way down and once more for backpropagation. Set it before the
+     * first search.
+     *
+     * @param storeStates True to store the State in every Node, false to
+     * store Actions only
+     */
+    void setStoreStates(bool storeStates) { this->storeStates = storeStates; }
+
+    /**
+     * @brief Limit the number of nodes of the search
+     *
+     * A search reaching it prunes the trees down to about half of it. In root
+     * parallel mode, the limit is for all trees together.
+     *
+     * @param maxNodes The number of nodes, the roots included, 0 for no limit
+     */
+    void setMaxNodes(unsigned int maxNodes) { this->maxNodes = maxNodes; }
+
+    /**
+     * @brief Limit the memory used by the search
+     *
+     * Counts the bytes used in the Arenas and the transposition tables. A
+     * search reaching it prunes the trees down to about half of it. Arenas
+     * allocate blocks of a MiB, getMemoryUsed() can be up to a block per
+     * thread over.
+     *
+     * @param maxBytes The number of bytes, 0 for no limit
+     */
+    void setMaxBytes(size_t maxBytes) { this->maxBytes = maxBytes; }
+
+    /**
+     * @brief Restart the random number generators from the given seed
+     *
+     * The generator of each thread is jumped ahead of the previous one, so
+     * their sequences do not overlap.
+     *
+     * @param seed The seed
+     */
+    void setSeed(uint64_t seed)
+    {
+        this->seed = seed;
+        randoms.clear();
+    }
+
+    /**
+     * @brief Share one Node between the paths reaching the same State
+     *
+     * Nodes already in the tree are not added to the table. In root parallel
+     * mode, each tree has a table of its own.
+     *
+     * @param entries The number of States the table can hold, rounded up to a
+     * power of two, 0 to search a tree without transpositions
+     */
+    void setTranspositionTableSize(size_t entries)
+    {
+        transpositionEntries = entries;
+        table.reset(entries ? new TranspositionTable<Node<T, A, E>>(entries) : nullptr);
+    }
+
+    /**
+     * @return The number of bytes taken by the transposition tables
+     */
+    size_t getTranspositionTableBytes()
+    {
+        size_t bytes = table ? table->getBytes() : 0;
+        for (const std::unique_ptr<RootTree>& tree : rootTrees)
+            bytes += tree->table ? tree->table->getBytes() : 0;
+        return bytes;
+    }
+
+    /**
+     * @return The number of lookups in the transposition tables
+     */
+    uint64_t getTranspositionLookups()
+    {
+        uint64_t lookups = table ? table->getLookups() : 0;
+        for (const std::unique_ptr<RootTree>& tree : rootTrees)
+            lookups += tree->table ? tree->table->getLookups() : 0;
+        return lookups;
+    }
+
+    /**
+     * @return The number of lookups in the transposition tables that found a
+     * Node, each saving a Node, its State and a playout
+     */
+    uint64_t getTranspositionHits()
+    {
+        uint64_t hits = table ? table->getHits() : 0;
+        for (const std::unique_ptr<RootTree>& tree : rootTrees)
+            hits += tree->table ? tree->table->getHits() : 0;
+        return hits;
+    }
+
+    /**
+     * @return The number of times the trees were pruned to fit the budget
+     */
+    unsigned int getNumPrunings() { return numPrunings; }
+
+    /**
+     * @return The number of bytes allocated by the search: the blocks of the
+     * Arenas and the transposition tables
+     */
+    size_t getMemoryUsed() { return getBytesReserved() + getTranspositionTableBytes(); }
+
     /**
      * Get the root of the MCTS tree. Useful for printing.
      * @see writeDotFile()
      * @return The root of the MCTS tree
      */
-    Node<T, A, E>& getRoot() { return root; }
+    Node<T, A, E>& getRoot() { return *root; }
+
+    /**
+     * @return The number of nodes in the tree, the root included
+     */
+    unsigned int getNumNodes() { return currentNodeID + 1 + rootTrees.size(); }
+
+    /**
+     * @return The number of search iterations run so far
+     */
+    unsigned int getIterations() { return iterations; }
+
+    /**
+     * @return The number of bytes the tree takes in its Arenas
+     */
+    size_t getBytesUsed()
+    {
+        size_t bytes = arena.getBytesUsed();
+        for (const std::unique_ptr<Arena>& a : workerArenas)
+            bytes += a->getBytesUsed();
+        for (const std::unique_ptr<RootTree>& tree : rootTrees)
+            bytes += tree->arena.getBytesUsed();
+        return bytes;
+    }
+
+    /**
+     * @return The number of bytes the Arenas holding the tree have allocated
+     */
+    size_t getBytesReserved()
+    {
+        size_t bytes = arena.getBytesReserved();
+        for (const std::unique_ptr<Arena>& a : workerArenas)
+            bytes += a->getBytesReserved();
+        for (const std::unique_ptr<RootTree>& tree : rootTrees)
+            bytes += tree->arena.getBytesReserved();
+        return bytes;
+    }
 
     ~MCTS()
     {
         delete backprop;
         delete termination;
         delete scoring;
+        delete rootData;
     }
 
 private:
+    using Slot = typename Node<T, A, E>::Children::Slot;
+
+    /** A Node on the path of an iteration, with the edge it was reached by */
+    struct Step {
+        Node<T, A, E>* node;
+        Slot slot;
+    };
+
+    /** Where copySubtree() copies a tree to */
+    struct CopyTarget {
+        CopyTarget(Arena& to, TranspositionTable<Node<T, A, E>>* table,
+            const std::unordered_set<Node<T, A, E>*>* interior = nullptr)
+            : to(to)
+            , table(table)
+            , interior(interior)
+        {
+        }
+
+        Arena& to;
+        /** The table the copies are added to, nullptr without transpositions */
+        TranspositionTable<Node<T, A, E>>* table;
+        /** The nodes whose children are copied, every node if nullptr. The
+         * others are copied as leaves, expanded again from scratch. */
+        const std::unordered_set<Node<T, A, E>*>* interior;
+        /** The number of nodes copied so far, numbering the copies */
+        unsigned int numNodes = 0;
+        /** The nodes copied so far with their copy, so that shared nodes are
+         * copied once, with transpositions only */
+        std::unordered_map<Node<T, A, E>*, Node<T, A, E>*> copies;
+    };
+
     void search()
     {
-        system_clock::time_point old = system_clock::now();
+        system_clock::time_point start = system_clock::now();
+        int loss = threads > 1 && !rootParallel ? virtualLoss : 0;
+        if (randoms.empty())
+            randoms.emplace_back(seed);
+        while (static_cast<int>(randoms.size()) < threads) {
+            randoms.push_back(randoms.back());
+            randoms.back().jump();
+        }
+        if (rootParallel) {
+            while (static_cast<int>(rootTrees.size()) < threads - 1)
+                rootTrees.push_back(createRootTree());
+        } else {
+            while (static_cast<int>(workerArenas.size()) < threads - 1)
+                workerArenas.emplace_back(new Arena());
+        }
+
+        expansionStopped = false;
+        while (true) {
+            treeBytes = getBytesUsed();
+            runThreads(start, loss);
+            if (!pruneRequested)
+                return;
+            pruneRequested = false;
+            prune();
+            // The children of the roots alone may not fit
+            if (overBudget())
+                expansionStopped = true;
+        }
+    }
+
+    /** Runs searchThread() on every thread, until the time is up or the budget
+     * is reached */
+    void runThreads(system_clock::time_point start, int loss)
+    {
+        std::vector<std::thread> workers;
+        for (int i = 0; i < threads - 1; i++) {
+            if (rootParallel) {
+                workers.emplace_back([this, i, start]() {
+                    RootTree& tree = *rootTrees[i];
+                    searchThread(
+                        tree.root, tree.table.get(), tree.arena, randoms[i + 1], start, 0);
+                });
+            } else {
+                workers.emplace_back([this, i, start, loss]() {
+                    searchThread(
+                        root, table.get(), *workerArenas[i], randoms[i + 1], start, loss);
+                });
+            }
+        }
+        searchThread(root, table.get(), arena, randoms[0], start, loss);
+        for (std::thread& worker : workers)
+            worker.join();
+    }
+
+    /** If the trees reached the node or byte budget */
+    bool overBudget()
+    {
+        return (maxNodes && getNumNodes() >= maxNodes)
+            || (maxBytes
+                && treeBytes.load(std::memory_order_relaxed) + getTranspositionTableBytes()
+                    >= maxBytes);
+    }
 
-        while (duration_cast<milliseconds>(system_clock::now() - old) < time || iterations < minIterations) {
-            iterations++;
+    /** Prunes every tree down to PRUNE_FRACTION of the budget. Every thread
+     * is stopped. */
+    void prune()
+    {
+        double fraction = 1;
+        if (maxNodes)
+            fraction = std::min(fraction, static_cast<double>(maxNodes) / getNumNodes());
+        if (maxBytes) {
+            size_t tableBytes = getTranspositionTableBytes();
+            fraction = std::min(fraction,
+                maxBytes > tableBytes ? static_cast<double>(maxBytes - tableBytes) / getBytesUsed()
+                                      : 0.0);
+        }
+        fraction *= PRUNE_FRACTION;
+
+        unsigned int numNodes = pruneTree(&root, &rootSlot, arena, rootData, table.get(), fraction);
+        // The nodes the other threads created were copied to arena
+        for (const std::unique_ptr<Arena>& a : workerArenas)
+            a->reset();
+        for (const std::unique_ptr<RootTree>& tree : rootTrees)
+            numNodes += pruneTree(
+                &tree->root, &tree->rootSlot, tree->arena, nullptr, tree->table.get(), fraction);
+        currentNodeID = numNodes - 1 - rootTrees.size();
+        numPrunings++;
+    }
+
+    /** Prunes the tree of *treeRoot to about fraction of its nodes, copying
+     * the rest from treeArena to fresh storage. The nodes with the most
+     * visits keep their children, the others become leaves. data is the State
+     * of the root if it does not live in treeArena, nullptr to copy it.
+     * Returns the number of nodes kept. */
+    unsigned int pruneTree(Node<T, A, E>** treeRoot, typename Node<T, A, E>::Children** treeSlot,
+        Arena& treeArena, T* data, TranspositionTable<Node<T, A, E>>* treeTable, double fraction)
+    {
+        // Rank the nodes with children by visits, the root first
+        std::vector<std::pair<int, Node<T, A, E>*>> parents;
+        std::unordered_set<Node<T, A, E>*> visited = { *treeRoot };
+        std::vector<Node<T, A, E>*> stack = { *treeRoot };
+        while (!stack.empty()) {
+            Node<T, A, E>* node = stack.back();
+            stack.pop_back();
+            if (node->getChildren().size() > 0)
+                parents.emplace_back(
+                    node == *treeRoot ? std::numeric_limits<int>::max() : getNumVisits(node), node);
+            node->getChildren().forEach([&](const A&, int, float, Node<T, A, E>* child) {
+                if (visited.insert(child).second)
+                    stack.push_back(child);
+            });
+        }
+        std::sort(parents.begin(), parents.end(),
+            [](const std::pair<int, Node<T, A, E>*>& a, const std::pair<int, Node<T, A, E>*>& b) {
+                return a.first > b.first;
+            });
+
+        // Keep the children of as many of them as fit, the root's always
+        size_t maxKept = static_cast<size_t>(fraction * visited.size());
+        size_t numKept = 1;
+        std::unordered_set<Node<T, A, E>*> interior;
+        for (const std::pair<int, Node<T, A, E>*>& parent : parents) {
+            size_t numChildren = parent.second->getChildren().size();
+            if (!interior.empty() && numKept + numChildren > maxKept)
+                break;
+            numKept += numChildren;
+            interior.insert(parent.second);
+        }
+
+        Arena kept;
+        CopyTarget target(kept, treeTable, &interior);
+        Node<T, A, E>* source = *treeRoot;
+        T* state = source->getData();
+        if (data == nullptr)
+            data = kept.create<T>(*state);
+        *treeSlot = kept.create<typename Node<T, A, E>::Children>();
+        if (treeTable)
+            treeTable->clear();
+        *treeRoot = copySubtree(source, target, data, state, nullptr, **treeSlot,
+            source->getAction(), source->getNumVisits(),
+            source->getSlot().score().load(std::memory_order_relaxed));
+        treeArena.swap(kept);
+        return target.numNodes;
+    }
+
+    /** Copies source and its subtree as a child of parent in children, with
+     * the given statistics. state is the State of source, needed when States
+     * are stored or with transpositions. The copy of source's State is data,
+     * or a new one if nullptr and States are stored. source may be nullptr for
+     * a node without children. */
+    Node<T, A, E>* copySubtree(Node<T, A, E>* source, CopyTarget& target, T* data,
+        const T* state, Node<T, A, E>* parent, typename Node<T, A, E>::Children& children,
+        const A& action, int visits, float score)
+    {
+        Arena& to = target.to;
+        Slot slot;
+        if (target.table != nullptr && target.copies.count(source)) {
+            Node<T, A, E>* copy = target.copies[source];
+            children.add(to, action, visits, [&](Slot s) {
+                slot = s;
+                return copy;
+            });
+            slot.score().store(score, std::memory_order_relaxed);
+            copy->setShared();
+            return copy;
+        }
+
+        if (data == nullptr && storeStates)
+            data = to.create<T>(*state);
+        Node<T, A, E>* node = children.add(to, action, visits, [&](Slot s) {
+            slot = s;
+            return to.create<Node<T, A, E>>(target.numNodes++, data, parent, s);
+        });
+        slot.score().store(score, std::memory_order_relaxed);
+        if (target.table != nullptr) {
+            if (source != nullptr) {
+                node->setTotal(source->getTotalScore(), source->getTotalVisits());
+                target.copies[source] = node;
+            }
+            target.table->insert(std::hash<T>()(*state), node);
+        }
+        // A node never expanded has no ExpansionStrategy, nor has a copy of a
+        // node fully expanded
+        if (source == nullptr || (source->getExpansion() == nullptr && source->shouldExpand()))
+            return node;
+        if (target.interior != nullptr && !target.interior->count(source))
+            return node;
+
+        if (source->shouldExpand()) {
+            E* expansion = to.create<E>(*source->getExpansion());
+            expansion->setState(data);
+            node->setExpansion(expansion);
+        } else {
+            node->setFullyExpanded();
+        }
+        source->getChildren().forEach([&](const A& childAction, int childVisits, float childScore,
+                                          Node<T, A, E>* child) {
+            if (storeStates || target.table == nullptr) {
+                copySubtree(child, target, nullptr, child->getData(), node, node->getChildren(),
+                    childAction, childVisits, childScore);
+                return;
+            }
+            // The table needs the State of the child, replayed from its parent's
+            T childState(*state);
+            A(childAction).execute(&childState);
+            copySubtree(child, target, nullptr, &childState, node, node->getChildren(),
+                childAction, childVisits, childScore);
+        });
+        return node;
+    }
+
+    /** Creates a tree for root parallel mode, whose root has a copy of the
+     * root State */
+    std::unique_ptr<RootTree> createRootTree()
+    {
+        std::unique_ptr<RootTree> tree(new RootTree());
+        T* data = tree->arena.template create<T>(*rootData);
+        tree->rootSlot = tree->arena.template create<typename Node<T, A, E>::Children>();
+        tree->root = tree->rootSlot->add(tree->arena, A(), 0, [&](Slot slot) {
+            return tree->arena.template create<Node<T, A, E>>(0, data, nullptr, slot);
+        });
+        if (transpositionEntries)
+            tree->table.reset(new TranspositionTable<Node<T, A, E>>(transpositionEntries));
+        return tree;
+    }
+
+    /** Runs iterations on the tree of treeRoot until the time is up and enough
+     * iterations were run. table is the transposition table of the tree, if
+     * any, random the generator of the thread. */
+    void searchThread(Node<T, A, E>* treeRoot, TranspositionTable<Node<T, A, E>>* table,
+        Arena& threadArena, Random& random, system_clock::time_point start, int loss)
+    {
+        std::vector<Step> path;
+        // The State of the last Node on the path, replayed from the root when
+        // States are not stored, and the State a playout runs on
+        std::optional<T> state;
+        while (true) {
+            // Claim an iteration, so that threads stop at minIterations exactly
+            unsigned int i = iterations.fetch_add(1, std::memory_order_relaxed);
+            bool done = duration_cast<milliseconds>(system_clock::now() - start) >= time
+                && i >= static_cast<unsigned int>(minIterations);
+            // Every thread stops for the tree to be pruned once one reaches the budget
+            if (!done && !expansionStopped && overBudget())
+                pruneRequested.store(true, std::memory_order_relaxed);
+            if (done || pruneRequested.load(std::memory_order_relaxed)) {
+                iterations.fetch_sub(1, std::memory_order_relaxed);
+                return;
+            }
 
             /**
              * Selection
              */
-            Node<T, A, E>* selected = &root;
-            while (!selected->shouldExpand())
-                selected = select(selected);
+            Node<T, A, E>* selected = treeRoot;
+            path.clear();
+            path.push_back({ selected, selected->getSlot() });
+            if (loss)
+                path.back().slot.visits().fetch_add(loss, std::memory_order_relaxed);
+            if (!storeStates)
+                state.emplace(*treeRoot->getData());
+            while (!selected->shouldExpand()) {
+                Slot slot;
+                selected = select(selected, random, &slot);
+                path.push_back({ selected, slot });
+                if (loss)
+                    slot.visits().fetch_add(loss, std::memory_order_relaxed);
+                if (!storeStates)
+                    A(slot.action()).execute(&*state);
+            }
+            T* data = storeStates ? selected->getData() : &*state;
 
-            if (termination->isTerminal(selected->getData())) {
-                backProp(selected, scoring->score(selected->getData()));
+            if (termination->isTerminal(data)) {
+                backProp(path, scoring->score(data), 1 - loss, table != nullptr);
                 continue;
             }
 
             /**
              * Expansion
              */
-            Node<T, A, E>* expanded;
-            int numVisits = selected->getNumVisits();
-            if (numVisits >= minT) {
-                expanded = expandNext(selected);
-            } else {
-                expanded = selected;
+            bool transposed = false;
+            // A node busy being expanded by another thread is simulated as is
+            if (!expansionStopped && getNumVisits(selected) >= minT && selected->tryLock()) {
+                size_t bytesUsed = threadArena.getBytesUsed();
+                if (selected->shouldExpand())
+                    path.push_back(expandNext(
+                        selected, data, table, threadArena, random, loss, &transposed));
+                selected->unlock();
+                treeBytes.fetch_add(
+                    threadArena.getBytesUsed() - bytesUsed, std::memory_order_relaxed);
+            }
+
+            // A State already in the tree gives its average instead of a playout,
+            // which its own totals hold already
+            Node<T, A, E>* expanded = path.back().node;
+            if (transposed && expanded->getTotalVisits() > 0) {
+                backProp(path, expanded->getTotalScore() / expanded->getTotalVisits(), 1 - loss,
+                    true, true);
+                continue;
             }
 
             /**
              * Simulation
              */
-            simulate(expanded);
+            if (storeStates)
+                state.emplace(*path.back().node->getData());
+            simulate(path, &*state, random, 1 - loss, table != nullptr);
         }
     }
 
-    /** Selects the best child node at the given node */
-    Node<T, A, E>* select(Node<T, A, E>* node)
+    /** The number of visits of node, by any path if it is shared */
+    int getNumVisits(Node<T, A, E>* node)
     {
-        Node<T, A, E>* best = nullptr;
-        float bestScore = -std::numeric_limits<float>::max();
+        return node->isShared() ? node->getTotalVisits() : node->getNumVisits();
+    }
 
-        std::vector<Node<T, A, E>*>& children = node->getChildren();
+    /** Selects the best child node at the given node, setting slot to the
+     * statistics of the edge to it */
+    Node<T, A, E>* select(Node<T, A, E>* node, Random& random, Slot* slot)
+    {
+        typename Node<T, A, E>::Children& children = node->getChildren();
+        int numVisits = getNumVisits(node);
 
         // Select randomly if the Node has not been visited often enough
-        if (node->getNumVisits() < minVisits)
-            return children[rand() % children.size()];
-
-        // Use the UCT formula for selection
-        for (Node<T, A, E>* n : children) {
-            float score = n->getAvgScore() + C * (float)sqrt(log(node->getNumVisits()) / n->getNumVisits());
-
-            if (score > bestScore) {
-                bestScore = score;
-                best = n;
-            }
-        }
-
-        return best;
+        if (numVisits < minVisits)
+            return children.get(random.below(children.size()), slot);
+
+        // Use the UCT formula for selection. Children whose playouts are not
+        // backpropagated yet have no visits without virtual loss and no UCT
+        // value, when none has one select randomly.
+        int index = children.selectUCTIndex(static_cast<float>(std::log(numVisits)), C);
+        if (index < 0)
+            index = random.below(children.size());
+        return children.get(index, slot);
     }
     /** Get the next Action for the given Node, execute and add the new Node to
-     * the tree. */
-    Node<T, A, E>* expandNext(Node<T, A, E>* node)
+     * the tree, or link the Node of the State reached found in table. data is
+     * the State of the Node, which the Action is executed on when States are
+     * not stored. The caller holds the lock of the Node. */
+    Step expandNext(Node<T, A, E>* node, T* data, TranspositionTable<Node<T, A, E>>* table,
+        Arena& threadArena, Random& random, int loss, bool* transposed)
     {
-        T* expandedData = new T(*node->getData());
-        A* action = node->generateNextAction();
-        action->execute(expandedData);
-        Node<T, A, E>* newNode = new Node<T, A, E>(++currentNodeID, expandedData, node, action);
-        node->addChild(newNode);
-        return newNode;
+        if (node->getExpansion() == nullptr)
+            node->setExpansion(threadArena.create<E>(data));
+        // The expansion of a node is used by whichever thread holds its lock,
+        // on the State that thread has
+        node->getExpansion()->setState(data);
+        node->getExpansion()->setRandom(&random);
+        A action;
+        node->getExpansion()->generateNext(&action);
+        bool fullyExpanded = !node->getExpansion()->canGenerateNext();
+        Step step;
+        auto addChild = [&](T* expandedData) {
+            return node->getChildren().add(threadArena, action, loss, [&](Slot slot) {
+                step.slot = slot;
+                return threadArena.create<Node<T, A, E>>(
+                    ++currentNodeID, expandedData, node, slot);
+            });
+        };
+        if (!storeStates) {
+            // The State replayed becomes the one of the child
+            action.execute(data);
+            if (table == nullptr)
+                step.node = addChild(nullptr);
+            else
+                step.node = table->findOrInsert(
+                    std::hash<T>()(*data), [&]() { return addChild(nullptr); }, transposed);
+        } else if (table == nullptr) {
+            T* expandedData = threadArena.create<T>(*data);
+            action.execute(expandedData);
+            step.node = addChild(expandedData);
+        } else {
+            T state(*data);
+            action.execute(&state);
+            step.node = table->findOrInsert(
+                std::hash<T>()(state),
+                [&]() { return addChild(threadArena.create<T>(state)); }, transposed);
+        }
+        if (*transposed) {
+            node->getChildren().add(threadArena, action, loss, [&](Slot slot) {
+                step.slot = slot;
+                return step.node;
+            });
+            step.node->setShared();
+        }
+        if (fullyExpanded)
+            node->setFullyExpanded();
+        return step;
     }
-    /** Simulate until the stopping condition is reached. */
-    void simulate(Node<T, A, E>* node)
+    /** Simulate until the stopping condition is reached, playing on state,
+     * the State of the last Node of the path. */
+    void simulate(const std::vector<Step>& path, T* state, Random& random, int visits, bool totals)
     {
-        T state(*node->getData());
         std::vector<Action<T>*> actions;
 
         A action;
         // Check if the end of the game is reached and generate the next state if
         // not
-        while (!termination->isTerminal(&state)) {
-            P playout(&state);
+        while (!termination->isTerminal(state)) {
+            P playout(state);
+            playout.setRandom(&random);
             playout.generateRandom(&action);
-            action.execute(&state);
+            action.execute(state);
         }
 
         // Score the leaf node (end of the game)
-        float s = scoring->score(&state);
+        float s = scoring->score(state);
 
-        backProp(node, s);
+        backProp(path, s, visits, totals);
     }
-    /** Backpropagate a score through the tree */
-    void backProp(Node<T, A, E>* node, float score)
+    /** Backpropagate a score along the path of an iteration, adding visits to
+     * each edge on the way, 1 minus the virtual loss added during selection.
+     * With totals, the totals of the nodes are updated too, see
+     * Node::addTotal(), except those of the last Node of the path when it is
+     * transposed, as the score is their average. */
+    void backProp(const std::vector<Step>& path, float score, int visits, bool totals,
+        bool transposed = false)
+    {
+        size_t last = path.size() - 1;
+        if (storeStates) {
+            for (size_t i = last; i > 0; i--)
+                updateStep(path[i], path[i].node->getData(), score, visits, totals,
+                    transposed && i == last);
+        } else {
+            // Replay the States from the root, updating the path downwards
+            T state(*path[0].node->getData());
+            for (size_t i = 1; i < path.size(); i++) {
+                A(path[i].slot.action()).execute(&state);
+                updateStep(path[i], &state, score, visits, totals, transposed && i == last);
+            }
+        }
+        path[0].slot.update(score, visits);
+        if (totals)
+            path[0].node->addTotal(score);
+    }
+
+    /** Backpropagate a score to one step of a path below the root, data
+     * being the State of its Node. The totals of a transposed Node are left
+     * as they are. */
+    void updateStep(
+        const Step& step, T* data, float score, int visits, bool totals, bool transposed)
     {
-        while (node->getParent() != 0) {
-            node->update(backprop->updateScore(node->getData(), score));
-            node = node->getParent();
+        step.slot.update(backprop->updateScore(data, score), visits);
+        if (!totals)
+            return;
+        if (!transposed)
+            step.node->addTotal(score);
+        if (step.node->isShared()) {
+            float average = step.node->getTotalScore() / step.node->getTotalVisits();
+            step.slot.score().store(backprop->updateScore(data, average)
+                    * step.slot.visits().load(std::memory_order_relaxed),
+                std::memory_order_relaxed);
         }
-        node->update(score);
     }
 };
 
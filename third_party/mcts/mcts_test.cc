@@ -0,0 +1,370 @@
+#include "third_party/mcts/mcts.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace {
+
+struct TestNode {
+    int id;
+};
+
+using TestChildren = ChildArray<int, TestNode>;
+
+// Reference for uctArgmax(), one child at a time.
+int scalarUctArgmax(const std::vector<int>& visits, const std::vector<float>& scores,
+    float logParentVisits, float C)
+{
+    int bestIndex = -1;
+    float best = -std::numeric_limits<float>::max();
+    for (int i = 0; i < static_cast<int>(visits.size()); i++) {
+        float n = static_cast<float>(visits[i]);
+        float value = scores[i] / n + C * std::sqrt(logParentVisits / n);
+        if (value > best) {
+            best = value;
+            bestIndex = i;
+        }
+    }
+    return bestIndex;
+}
+
+TEST(MCTSTest, UctArgmax)
+{
+    srand(1);
+    for (int count = 0; count < 70; count++) {
+        std::vector<int> visits(count);
+        std::vector<float> scores(count);
+        for (int i = 0; i < count; i++) {
+            visits[i] = 1 + rand() % 1000;
+            scores[i] = static_cast<float>(rand() % (visits[i] + 1));
+        }
+        float best;
+        EXPECT_EQ(uctArgmax(visits.data(), scores.data(), count, 9.5f, 0.5f, &best),
+            scalarUctArgmax(visits, scores, 9.5f, 0.5f));
+    }
+}
+
+TEST(MCTSTest, UctArgmaxTies)
+{
+    std::vector<int> visits(37, 4);
+    std::vector<float> scores(37, 2);
+    float best;
+    EXPECT_EQ(uctArgmax(visits.data(), scores.data(), 37, 3, 0.5f, &best), 0);
+    visits[13] = visits[29] = 2;
+    scores[13] = scores[29] = 1;
+    EXPECT_EQ(uctArgmax(visits.data(), scores.data(), 37, 3, 0.5f, &best), 13);
+    EXPECT_FLOAT_EQ(best, 0.5f + 0.5f * std::sqrt(1.5f));
+}
+
+TEST(MCTSTest, Random)
+{
+    Random random(7);
+    Random same(7);
+    Random other(8);
+    Random jumped(7);
+    jumped.jump();
+    int differentSeed = 0;
+    int differentJump = 0;
+    for (int i = 0; i < 100; i++) {
+        uint64_t value = random.next();
+        EXPECT_EQ(same.next(), value);
+        differentSeed += other.next() != value;
+        differentJump += jumped.next() != value;
+    }
+    EXPECT_EQ(differentSeed, 100);
+    EXPECT_EQ(differentJump, 100);
+
+    // Every value below n is drawn about as often.
+    const uint32_t n = 6;
+    std::vector<int> counts(n);
+    for (int i = 0; i < 60000; i++) {
+        uint32_t value = random.below(n);
+        ASSERT_LT(value, n);
+        counts[value]++;
+    }
+    for (int count : counts)
+        EXPECT_NEAR(count, 10000, 500);
+    EXPECT_EQ(random.below(1), 0);
+    EXPECT_LT(random.below(0xffffffff), 0xffffffff);
+
+    random.setSeed(7);
+    same.setSeed(7);
+    EXPECT_EQ(random.next(), same.next());
+}
+
+TEST(MCTSTest, ChildArray)
+{
+    Arena arena;
+    TestChildren children;
+    std::vector<TestChildren::Slot> slots;
+    for (int i = 0; i < 40; i++) {
+        TestNode* node = children.add(arena, 100 + i, 0, [&](TestChildren::Slot slot) {
+            slots.push_back(slot);
+            return arena.create<TestNode>(TestNode{ i });
+        });
+        EXPECT_EQ(node->id, i);
+    }
+    ASSERT_EQ(children.size(), 40);
+    for (int i = 0; i < 40; i++) {
+        EXPECT_EQ(children.get(i)->id, i);
+        EXPECT_EQ(slots[i].action(), 100 + i);
+        slots[i].visits() = 10;
+        slots[i].score() = 5;
+    }
+    slots[33].score() = 6;
+    EXPECT_EQ(children.selectBestAverage()->id, 33);
+    EXPECT_EQ(children.selectUCT(4, 0.5f)->id, 33);
+    slots[21].visits() = 1;
+    slots[21].score() = 0;
+    EXPECT_EQ(children.selectUCT(4, 0.5f)->id, 21);
+
+    int visited = 0;
+    children.forEach([&](int action, int, float, TestNode* node) {
+        EXPECT_EQ(action, 100 + node->id);
+        visited++;
+    });
+    EXPECT_EQ(visited, 40);
+}
+
+TEST(MCTSTest, Arena)
+{
+    Arena arena;
+    EXPECT_EQ(arena.getBytesUsed(), 0);
+    std::vector<int*> ints;
+    for (int i = 0; i < 100000; i++)
+        ints.push_back(arena.create<int>(i));
+    for (int i = 0; i < 100000; i++)
+        ASSERT_EQ(*ints[i], i);
+    EXPECT_EQ(arena.getBytesUsed(), 100000 * sizeof(int));
+    size_t reserved = arena.getBytesReserved();
+    EXPECT_GE(reserved, arena.getBytesUsed());
+
+    double* aligned = static_cast<double*>(arena.allocate(sizeof(double), 64));
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(aligned) % 64, 0);
+    // Larger than a block.
+    char* large = static_cast<char*>(arena.allocate(3 << 20, 8));
+    large[(3 << 20) - 1] = 1;
+
+    // Blocks are kept for reuse.
+    arena.reset();
+    EXPECT_EQ(arena.getBytesUsed(), 0);
+    for (int i = 0; i < 100000; i++)
+        arena.create<int>(i);
+    EXPECT_EQ(arena.getBytesReserved(), reserved + (3 << 20));
+}
+
+int numDestroyed = 0;
+
+struct Counted {
+    ~Counted() { numDestroyed++; }
+};
+
+TEST(MCTSTest, ArenaDestructors)
+{
+    {
+        Arena arena;
+        arena.create<Counted>();
+        arena.create<Counted>();
+        arena.reset();
+        EXPECT_EQ(numDestroyed, 2);
+        arena.create<Counted>();
+    }
+    EXPECT_EQ(numDestroyed, 3);
+}
+
+TEST(MCTSTest, ArenaSwap)
+{
+    numDestroyed = 0;
+    Arena arena;
+    int* kept = arena.create<int>(7);
+    {
+        Arena other;
+        other.create<Counted>();
+        arena.swap(other);
+        EXPECT_EQ(arena.getBytesUsed(), sizeof(Counted));
+        EXPECT_EQ(other.getBytesUsed(), sizeof(int));
+        EXPECT_EQ(*kept, 7);
+    }
+    EXPECT_EQ(numDestroyed, 0);
+    arena.reset();
+    EXPECT_EQ(numDestroyed, 1);
+}
+
+struct VisitedNode {
+    int visits;
+    int getTotalVisits() { return visits; }
+};
+
+TEST(MCTSTest, TranspositionTable)
+{
+    TranspositionTable<VisitedNode> table(7);
+    EXPECT_EQ(table.getCapacity(), 8);
+    std::vector<VisitedNode> nodes = { { 5 }, { 2 }, { 9 }, { 3 }, { 4 } };
+    bool found;
+    // Keys of one bucket, the one of the fewest visits is replaced when it is full.
+    for (int i = 0; i < 4; i++)
+        EXPECT_EQ(table.findOrInsert(2 * i, [&]() { return &nodes[i]; }, &found), &nodes[i]);
+    EXPECT_FALSE(found);
+    EXPECT_EQ(table.findOrInsert(4, [&]() { return &nodes[4]; }, &found), &nodes[2]);
+    EXPECT_TRUE(found);
+    table.insert(8, &nodes[4]);
+    EXPECT_EQ(table.getReplacements(), 1);
+    EXPECT_EQ(table.findOrInsert(2, [&]() { return &nodes[1]; }, &found), &nodes[1]);
+    EXPECT_FALSE(found);
+    EXPECT_EQ(table.getReplacements(), 2);
+    EXPECT_EQ(table.findOrInsert(8, [&]() { return &nodes[0]; }, &found), &nodes[4]);
+    EXPECT_TRUE(found);
+    EXPECT_EQ(table.getLookups(), 8);
+    EXPECT_EQ(table.getHits(), 2);
+
+    table.clear();
+    EXPECT_EQ(table.getLookups(), 0);
+    EXPECT_EQ(table.findOrInsert(0, [&]() { return &nodes[1]; }, &found), &nodes[1]);
+    EXPECT_FALSE(found);
+}
+
+// A game adding 1, 2 or 3 to a total for SUM_PLIES plies, won if the total is
+// even. Orders of the same additions transpose.
+constexpr int SUM_PLIES = 6;
+
+struct SumState {
+    int total = 0;
+    int ply = 0;
+};
+
+struct AddAction {
+    int value = 0;
+
+    void execute(SumState* state) const
+    {
+        state->total += value;
+        state->ply++;
+    }
+    bool operator==(const AddAction& other) const { return value == other.value; }
+};
+
+class SumExpansion : public ExpansionStrategy<SumState, AddAction> {
+    int next = 1;
+
+public:
+    explicit SumExpansion(SumState* state)
+        : ExpansionStrategy<SumState, AddAction>(state)
+    {
+    }
+
+    void generateNext(AddAction* action) override { action->value = next++; }
+    bool canGenerateNext() override { return next <= 3; }
+};
+
+class SumPlayout : public PlayoutStrategy<SumState, AddAction> {
+public:
+    explicit SumPlayout(SumState* state)
+        : PlayoutStrategy<SumState, AddAction>(state)
+    {
+    }
+
+    void generateRandom(AddAction* action) override { action->value = 1 + random->below(3); }
+};
+
+class SumBackpropagation : public Backpropagation<SumState> {
+public:
+    float updateScore(SumState*, float score) override { return score; }
+};
+
+class SumTermination : public TerminationCheck<SumState> {
+public:
+    bool isTerminal(SumState* state) override { return state->ply >= SUM_PLIES; }
+};
+
+class SumScoring : public Scoring<SumState> {
+public:
+    float score(SumState* state) override { return state->total % 2 == 0; }
+};
+
+} // namespace
+
+namespace std {
+
+template <>
+struct hash<SumState> {
+    size_t operator()(const SumState& state) const { return state.ply * 1000 + state.total; }
+};
+
+template <>
+struct hash<AddAction> {
+    size_t operator()(const AddAction& action) const { return action.value; }
+};
+
+} // namespace std
+
+namespace {
+
+using SumNode = Node<SumState, AddAction, SumExpansion>;
+
+TEST(MCTSTest, Transpositions)
+{
+    MCTS<SumState, AddAction, SumExpansion, SumPlayout> mcts(new SumState(),
+        new SumBackpropagation(), new SumTermination(), new SumScoring());
+    mcts.setSeed(2);
+    mcts.setTime(0);
+    mcts.setMinIterations(2000);
+    mcts.setTranspositionTableSize(1024);
+    std::unique_ptr<AddAction> action(mcts.calculateAction());
+    EXPECT_EQ(mcts.getRoot().getNumVisits(), 2000);
+    EXPECT_GT(mcts.getTranspositionHits(), 0);
+    EXPECT_EQ(mcts.getNumNodes(), 1 + mcts.getTranspositionLookups() - mcts.getTranspositionHits());
+
+    // One node per state: totals 0 to 3 * ply at each ply below SUM_PLIES.
+    int numStates = 0;
+    for (int ply = 0; ply <= SUM_PLIES; ply++)
+        numStates += 2 * ply + 1;
+    EXPECT_LE(mcts.getNumNodes(), numStates);
+
+    // Each playout through a node goes through one of the edges to it. An
+    // edge linked to a node already visited takes its average instead, once,
+    // without adding to its totals.
+    std::vector<SumNode*> stack = { &mcts.getRoot() };
+    std::map<SumNode*, int> edgeVisits = { { &mcts.getRoot(), 2000 } };
+    std::map<SumNode*, int> numParents;
+    std::vector<SumNode*> visited;
+    while (!stack.empty()) {
+        SumNode* node = stack.back();
+        stack.pop_back();
+        if (std::find(visited.begin(), visited.end(), node) != visited.end())
+            continue;
+        visited.push_back(node);
+        node->getChildren().forEach([&](const AddAction&, int visits, float, SumNode* child) {
+            edgeVisits[child] += visits;
+            numParents[child]++;
+            stack.push_back(child);
+        });
+    }
+    EXPECT_EQ(visited.size(), mcts.getNumNodes());
+    int numShared = 0;
+    int numAverages = 0;
+    for (SumNode* node : visited) {
+        EXPECT_LE(node->getTotalVisits(), edgeVisits[node]);
+        EXPECT_GE(node->getTotalVisits(), edgeVisits[node] - std::max(numParents[node] - 1, 0));
+        EXPECT_EQ(node->isShared(), numParents[node] > 1);
+        numShared += node->isShared();
+        numAverages += edgeVisits[node] - node->getTotalVisits();
+    }
+    EXPECT_GT(numShared, 0);
+    EXPECT_GT(numAverages, 0);
+
+    // Tree reuse keeps the shared nodes shared.
+    int kept = mcts.advance(*action);
+    EXPECT_GT(kept, 1);
+    EXPECT_EQ(mcts.getNumNodes(), kept);
+    mcts.setMinIterations(500);
+    action.reset(mcts.calculateAction());
+    EXPECT_EQ(mcts.getIterations(), 500);
+}
+
+} // namespace